@@ -0,0 +1,16 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 fragCell;
+layout(location = 1) flat in uvec2 fragGlyph;
+layout(location = 2) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+// 8x8 bitmap, a byte per row, rows 0-3 in x and 4-7 in y
+void main() {
+  uvec2 cell = min(uvec2(fragCell), uvec2(7u));
+  uint rows = cell.y < 4u ? fragGlyph.x : fragGlyph.y;
+  if (((rows >> ((cell.y & 3u) * 8u + cell.x)) & 1u) == 0u) discard;
+  outColor = fragColor;
+}
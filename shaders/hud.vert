@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(push_constant) uniform Screen {
+  mat4 pixelToClip;
+} screen;
+
+// One quad per instance, see HudQuad
+layout(location = 0) in vec4 inRect;
+layout(location = 1) in uvec2 inGlyph;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 fragCell;
+layout(location = 1) flat out uvec2 fragGlyph;
+layout(location = 2) out vec4 fragColor;
+
+void main() {
+  vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+  gl_Position = screen.pixelToClip * vec4(inRect.xy + corner * inRect.zw, 0.0, 1.0);
+  fragCell = corner * 8.0;
+  fragGlyph = inGlyph;
+  fragColor = inColor;
+}
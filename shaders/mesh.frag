@@ -0,0 +1,14 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+const vec3 lightDirection = normalize(vec3(0.4, 0.8, 0.6));
+
+void main() {
+  float diffuse = max(dot(normalize(fragNormal), lightDirection), 0.0);
+  outColor = vec4(fragColor * (0.25 + 0.75 * diffuse), 1.0);
+}
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(push_constant) uniform Camera {
+  mat4 viewProj;
+} camera;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUv;
+layout(location = 4) in mat4 inModel;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+void main() {
+  gl_Position = camera.viewProj * inModel * vec4(inPosition, 1.0);
+  fragNormal = normalize(mat3(inModel) * inNormal);
+  fragColor = fragNormal * 0.5 + 0.5;
+}
@@ -0,0 +1,282 @@
+#include "capture.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace CaptureFormat;
+
+namespace {
+
+template <typename T>
+std::span<const std::byte> bytesOf(const T& value)
+{
+    return std::as_bytes(std::span<const T, 1>{&value, 1});
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void CaptureWriter::open(const std::string& filename, uint32_t viewCount)
+{
+    m_out.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_out) throw std::runtime_error{"failed to open capture file!"};
+
+    Header header    = {};
+    header.magic     = MAGIC;
+    header.version   = VERSION;
+    header.viewCount = viewCount;
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void CaptureWriter::close()
+{
+    if (!isOpen()) return;
+
+    m_out.close();
+    if (m_out.fail()) throw std::runtime_error{"failed to write capture file!"};
+}
+
+void CaptureWriter::mesh(uint32_t mesh, std::span<const std::byte> payload,
+                         uint64_t indexPayloadOffset, uint32_t indexSize,
+                         std::span<const MeshFormat::Lod> lods)
+{
+    if (!isOpen()) return;
+
+    MeshRecord record         = {};
+    record.mesh               = mesh;
+    record.indexSize          = indexSize;
+    record.indexPayloadOffset = indexPayloadOffset;
+    record.lodCount           = std::min<size_t>(lods.size(), MeshFormat::MAX_LODS);
+    std::copy_n(lods.begin(), record.lodCount, record.lods);
+
+    write(MESH, bytesOf(record), payload);
+}
+
+void CaptureWriter::pipeline(uint32_t pipeline, const PipelineDesc& desc)
+{
+    if (!isOpen()) return;
+
+    PipelineRecord record       = {};
+    record.pipeline             = pipeline;
+    record.meshVertices         = desc.meshVertices;
+    record.overlay              = desc.overlay;
+    record.vertexShaderLength   = desc.vertexShader.size();
+    record.fragmentShaderLength = desc.fragmentShader.size();
+
+    std::string paths = desc.vertexShader + desc.fragmentShader;
+    write(PIPELINE, bytesOf(record), std::as_bytes(std::span{paths}));
+}
+
+void CaptureWriter::resize(uint32_t view, VkExtent2D extent)
+{
+    if (!isOpen()) return;
+
+    ResizeRecord record = {view, extent.width, extent.height, 0};
+    write(RESIZE, bytesOf(record));
+}
+
+void CaptureWriter::instances(uint64_t version, std::span<const Mat4> instances)
+{
+    if (!isOpen() || (m_instancesWritten && version == m_instanceVersion)) return;
+
+    m_instanceVersion  = version;
+    m_instancesWritten = true;
+    write(INSTANCES, std::as_bytes(instances));
+}
+
+void CaptureWriter::beginDraws()
+{
+    m_draws.clear();
+}
+
+void CaptureWriter::draw(const DrawCommand& command, float depth)
+{
+    if (isOpen()) m_draws.push_back({command, depth});
+}
+
+void CaptureWriter::endFrame(uint64_t frame)
+{
+    if (!isOpen()) return;
+
+    // DrawCommand has no padding, so comparing bytes is comparing fields
+    bool changed = !m_drawsWritten || m_draws.size() != m_writtenDraws.size() ||
+                   std::memcmp(m_draws.data(), m_writtenDraws.data(),
+                               m_draws.size() * sizeof(Draw)) != 0;
+    if (changed) {
+        write(DRAWS, std::as_bytes(std::span{m_draws}));
+        m_writtenDraws = m_draws;
+        m_drawsWritten = true;
+    }
+
+    FrameRecord record = {frame};
+    write(FRAME, bytesOf(record));
+}
+
+void CaptureWriter::write(RecordType type, std::span<const std::byte> fixed,
+                          std::span<const std::byte> tail)
+{
+    RecordHeader header = {type, static_cast<uint32_t>(fixed.size() + tail.size())};
+    m_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_out.write(reinterpret_cast<const char*>(fixed.data()), fixed.size());
+    m_out.write(reinterpret_cast<const char*>(tail.data()), tail.size());
+
+    static constexpr char PADDING[RECORD_ALIGNMENT] = {};
+    m_out.write(PADDING, alignRecord(header.size) - header.size);
+}
+
+//------------------------------------------------------------------------------
+
+CaptureReader::CaptureReader(const std::string& filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error{"failed to open capture file!"};
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        throw std::runtime_error{"invalid capture file!"};
+    }
+    m_size = st.st_size;
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED) throw std::runtime_error{"failed to map capture file!"};
+
+    m_data   = static_cast<const std::byte*>(data);
+    m_header = reinterpret_cast<const Header*>(m_data);
+
+    madvise(data, m_size, MADV_SEQUENTIAL); // Advice values are not flags
+    madvise(data, m_size, MADV_WILLNEED);
+
+    if (!validate()) {
+        munmap(data, m_size);
+        throw std::runtime_error{"invalid capture file!"};
+    }
+}
+
+CaptureReader::~CaptureReader()
+{
+    munmap(const_cast<std::byte*>(m_data), m_size);
+}
+
+bool CaptureReader::next(Record& record)
+{
+    if (m_offset >= m_size) return false;
+
+    RecordHeader header;
+    std::memcpy(&header, m_data + m_offset, sizeof(header));
+
+    record.type    = static_cast<RecordType>(header.type);
+    record.payload = {m_data + m_offset + sizeof(header), header.size};
+    m_offset += sizeof(header) + alignRecord(header.size);
+    return true;
+}
+
+// Walks every record once, so next() can trust sizes and types
+bool CaptureReader::validate()
+{
+    const auto& h = *m_header;
+    if (h.magic != MAGIC || h.version != VERSION || h.viewCount == 0) return false;
+
+    // What draws may refer to at this point of the file; index counts are
+    // per mesh, and the triangle's vertices stand in for its indices
+    uint32_t pipelineCount = 0;
+    std::vector<uint64_t> meshIndexCounts(FIRST_MESH, BUILTIN_MESH_VERTICES);
+    uint64_t instanceCount = 0;
+    uint64_t drawInstances = 0; // Instances the current draw list reads
+
+    Record record;
+    while (m_offset < m_size) {
+        if (m_size - m_offset < sizeof(RecordHeader)) return false;
+
+        RecordHeader header;
+        std::memcpy(&header, m_data + m_offset, sizeof(header));
+        if (alignRecord(header.size) > m_size - m_offset - sizeof(header)) return false;
+        next(record);
+
+        size_t size = record.payload.size();
+        switch (record.type) {
+        case MESH: {
+            if (size < sizeof(MeshRecord)) return false;
+            auto mesh = record.get<MeshRecord>();
+            if (mesh.mesh != meshIndexCounts.size() || mesh.lodCount < 1 ||
+                mesh.lodCount > MeshFormat::MAX_LODS ||
+                (mesh.indexSize != 2 && mesh.indexSize != 4) ||
+                mesh.indexPayloadOffset > size - sizeof(MeshRecord) ||
+                mesh.indexPayloadOffset % mesh.indexSize != 0)
+                return false;
+
+            // The payload is bound as both the vertex and the index buffer,
+            // so indices may reach anything before the index data
+            uint64_t indexBytes = size - sizeof(MeshRecord) - mesh.indexPayloadOffset;
+            uint64_t indexCount = indexBytes / mesh.indexSize;
+            if (indexBytes % mesh.indexSize != 0) return false;
+            for (uint32_t i = 0; i < mesh.lodCount; ++i) {
+                const auto& lod = mesh.lods[i];
+                if (lod.firstIndex % 3 != 0 || lod.indexCount % 3 != 0 ||
+                    uint64_t{lod.firstIndex} + lod.indexCount > indexCount)
+                    return false;
+            }
+
+            auto payload = record.tail<MeshRecord>();
+            if (!MeshFormat::indicesInRange(payload.data() + mesh.indexPayloadOffset, indexCount,
+                                            mesh.indexSize,
+                                            mesh.indexPayloadOffset / sizeof(MeshFormat::Vertex)))
+                return false;
+            meshIndexCounts.push_back(indexCount);
+            break;
+        }
+        case PIPELINE: {
+            if (size < sizeof(PipelineRecord)) return false;
+            auto pipeline = record.get<PipelineRecord>();
+            if (pipeline.pipeline != pipelineCount++ ||
+                uint64_t{pipeline.vertexShaderLength} + pipeline.fragmentShaderLength !=
+                    size - sizeof(PipelineRecord))
+                return false;
+            break;
+        }
+        case RESIZE:
+            if (size != sizeof(ResizeRecord) || record.get<ResizeRecord>().view >= h.viewCount)
+                return false;
+            break;
+        case INSTANCES:
+            if (size % sizeof(Mat4) != 0) return false;
+            instanceCount      = size / sizeof(Mat4);
+            m_maxInstanceCount = std::max<uint32_t>(m_maxInstanceCount, instanceCount);
+            break;
+        case DRAWS: {
+            if (size % sizeof(Draw) != 0) return false;
+
+            drawInstances = 0;
+            for (size_t offset = 0; offset < size; offset += sizeof(Draw)) {
+                Draw draw;
+                std::memcpy(&draw, record.payload.data() + offset, sizeof(draw));
+
+                const DrawCommand& command = draw.command;
+                if (command.pipeline >= pipelineCount || command.mesh >= meshIndexCounts.size() ||
+                    uint64_t{command.firstIndex} + command.count > meshIndexCounts[command.mesh])
+                    return false;
+                drawInstances = std::max(drawInstances, uint64_t{command.firstInstance} +
+                                                            command.instanceCount);
+            }
+            break;
+        }
+        case FRAME:
+            // Instances may shrink under an unchanged draw list
+            if (size != sizeof(FrameRecord) || drawInstances > instanceCount) return false;
+            ++m_frameCount;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    m_offset = sizeof(Header);
+    return true;
+}
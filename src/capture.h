@@ -0,0 +1,206 @@
+#pragma once
+
+#include "draw_list.h"
+#include "mat4.h"
+#include "mesh_format.h"
+#include "pipeline_compiler.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Binary trace of everything the application hands the renderer, replayed
+// by the replay tool without the rest of the application. Layout:
+//
+//   Header
+//   records, each a RecordHeader and size bytes of payload, padded to
+//   RECORD_ALIGNMENT
+//
+// Records apply in file order and a FRAME record ends each frame. Instances
+// and draws are only written when they changed. Pipeline and mesh ids count
+// up in file order, so replay recreates them with the same ids; mesh 0 is
+// the built-in triangle and never captured. Little-endian only.
+namespace CaptureFormat {
+
+constexpr uint32_t MAGIC            = 0x5443'5456; // "VTCT"
+constexpr uint32_t VERSION          = 2;
+constexpr uint32_t RECORD_ALIGNMENT = 8;
+
+constexpr uint32_t FIRST_MESH            = 1;
+constexpr uint32_t BUILTIN_MESH_VERTICES = 3; // Of mesh 0, generated by its shader
+
+enum RecordType : uint32_t
+{
+    MESH = 1,  // MeshRecord, then the mesh payload
+    PIPELINE,  // PipelineRecord, then both shader paths
+    RESIZE,    // ResizeRecord; a view's swap chain was (re)created
+    INSTANCES, // Every instance's world matrix
+    DRAWS,     // The whole draw list, as Draws in add order
+    FRAME,     // FrameRecord
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t viewCount;
+    uint32_t reserved;
+};
+
+struct RecordHeader
+{
+    uint32_t type;
+    uint32_t size; // Of the payload, without padding
+};
+
+struct MeshRecord
+{
+    uint32_t mesh;
+    uint32_t indexSize;
+    uint64_t indexPayloadOffset;
+    uint32_t lodCount;
+    uint32_t reserved;
+    MeshFormat::Lod lods[MeshFormat::MAX_LODS];
+};
+
+struct PipelineRecord
+{
+    uint32_t pipeline;
+    uint32_t meshVertices;
+    uint32_t overlay;
+    uint32_t vertexShaderLength;
+    uint32_t fragmentShaderLength;
+};
+
+struct ResizeRecord
+{
+    uint32_t view;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+};
+
+struct Draw
+{
+    DrawCommand command;
+    float depth;
+};
+
+struct FrameRecord
+{
+    uint64_t frame; // Frame number in the captured run
+};
+
+static_assert(std::is_trivially_copyable_v<MeshRecord> && sizeof(MeshRecord) == 152);
+static_assert(std::is_trivially_copyable_v<Draw> && sizeof(Draw) == 40);
+static_assert(sizeof(Mat4) == 64);
+
+constexpr uint64_t alignRecord(uint64_t offset)
+{
+    return (offset + RECORD_ALIGNMENT - 1) & ~uint64_t{RECORD_ALIGNMENT - 1};
+}
+
+} // namespace CaptureFormat
+
+//------------------------------------------------------------------------------
+
+// Writes a capture while the application runs. Every call is a no-op until
+// open(), so the capture points can stay in place.
+class CaptureWriter
+{
+  public:
+    void open(const std::string& filename, uint32_t viewCount);
+    void close();
+
+    bool isOpen() const { return m_out.is_open(); }
+
+    void mesh(uint32_t mesh, std::span<const std::byte> payload, uint64_t indexPayloadOffset,
+              uint32_t indexSize, std::span<const MeshFormat::Lod> lods);
+    void pipeline(uint32_t pipeline, const PipelineDesc& desc);
+    void resize(uint32_t view, VkExtent2D extent);
+
+    // Written when version differs from the last one written
+    void instances(uint64_t version, std::span<const Mat4> instances);
+
+    // A rebuilt draw list starts with beginDraws(); endFrame() writes it if
+    // it differs from the last one written
+    void beginDraws();
+    void draw(const DrawCommand& command, float depth);
+
+    void endFrame(uint64_t frame);
+
+  private:
+    void write(CaptureFormat::RecordType type, std::span<const std::byte> fixed,
+               std::span<const std::byte> tail = {});
+
+    std::ofstream m_out;
+    std::vector<CaptureFormat::Draw> m_draws;
+    std::vector<CaptureFormat::Draw> m_writtenDraws;
+    bool m_drawsWritten        = false;
+    uint64_t m_instanceVersion = 0;
+    bool m_instancesWritten    = false;
+};
+
+//------------------------------------------------------------------------------
+
+// Read-only memory mapping of a capture. Every record is validated up front,
+// including the ids and ranges draws refer to, so replay only has to check
+// what depends on its own state.
+class CaptureReader
+{
+  public:
+    struct Record
+    {
+        CaptureFormat::RecordType type;
+        std::span<const std::byte> payload;
+
+        // The fixed-size struct at the start of the payload
+        template <typename T>
+        T get() const
+        {
+            T value;
+            std::memcpy(&value, payload.data(), sizeof(T));
+            return value;
+        }
+
+        template <typename T>
+        std::span<const std::byte> tail() const
+        {
+            return payload.subspan(sizeof(T));
+        }
+    };
+
+    explicit CaptureReader(const std::string& filename);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&)            = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    const CaptureFormat::Header& header() const { return *m_header; }
+
+    uint64_t frameCount() const { return m_frameCount; }
+    uint32_t maxInstanceCount() const { return m_maxInstanceCount; }
+
+    // Next record in file order; false past the last one
+    bool next(Record& record);
+
+  private:
+    bool validate();
+
+    const std::byte* m_data = nullptr;
+    size_t m_size           = 0;
+    size_t m_offset         = sizeof(CaptureFormat::Header);
+    const CaptureFormat::Header* m_header;
+
+    uint64_t m_frameCount       = 0;
+    uint32_t m_maxInstanceCount = 0;
+};
@@ -0,0 +1,201 @@
+#include "draw_list.h"
+
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <cassert>
+#include <ostream>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t RADIX_BITS = 8;
+constexpr uint32_t BUCKETS    = 1u << RADIX_BITS;
+
+// Below this the per-pass fork/join costs more than it saves
+constexpr size_t PARALLEL_SORT_THRESHOLD = 16384;
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void DrawStats::print(std::ostream& out) const
+{
+    out << "Draws: " << draws << " (" << drawsSkipped << " skipped), sort " << sortNs / 1000.0
+        << " us, binds elided " << bindsElided() << " (pipeline " << pipelineBindsElided << '/'
+        << pipelineBinds + pipelineBindsElided << ", descriptor " << descriptorBindsElided << '/'
+        << descriptorBinds + descriptorBindsElided << ", vertex " << vertexBindsElided << '/'
+        << vertexBinds + vertexBindsElided << ")\n";
+}
+
+//------------------------------------------------------------------------------
+
+void DrawList::clear()
+{
+    m_commands.clear();
+    m_entries.clear();
+    m_stats = {};
+}
+
+void DrawList::add(const DrawCommand& command, float depth)
+{
+    assert(SortKey::fits(command.pass, SortKey::PASS_BITS));
+    assert(SortKey::fits(command.pipeline, SortKey::PIPELINE_BITS));
+    assert(SortKey::fits(command.material, SortKey::MATERIAL_BITS));
+    assert(SortKey::fits(command.mesh, SortKey::MESH_BITS));
+
+    uint64_t key = SortKey::make(command.pass, command.pipeline, command.material, command.mesh,
+                                 SortKey::quantizeDepth(depth));
+
+    m_entries.push_back({key, static_cast<uint32_t>(m_commands.size())});
+    m_commands.push_back(command);
+}
+
+void DrawList::sort(ThreadPool& pool)
+{
+    PROFILE_ZONE("DrawList::sort");
+
+    uint64_t start = Profiler::now();
+    radixSort(pool);
+    m_stats.sortNs = Profiler::now() - start;
+}
+
+void DrawList::radixSort(ThreadPool& pool)
+{
+    size_t n = m_entries.size();
+    if (n < 2) return;
+
+    m_scratch.resize(n);
+
+    // Digits shared by every key cannot reorder anything, skip their passes
+    uint64_t anyBits = 0;
+    uint64_t allBits = ~uint64_t{0};
+    for (const auto& entry : m_entries) {
+        anyBits |= entry.key;
+        allBits &= entry.key;
+    }
+    uint64_t varyingBits = anyBits ^ allBits;
+
+    size_t blockCount = n >= PARALLEL_SORT_THRESHOLD ? pool.concurrency() : 1;
+    size_t blockSize  = (n + blockCount - 1) / blockCount;
+
+    // Rounding blockSize up can leave fewer chunks than threads; a histogram
+    // without a chunk would keep stale offsets and break the scan
+    blockCount = (n + blockSize - 1) / blockSize;
+    std::vector<std::array<uint32_t, BUCKETS>> histograms(blockCount);
+
+    Entry* src = m_entries.data();
+    Entry* dst = m_scratch.data();
+
+    for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS) {
+        if (((varyingBits >> shift) & (BUCKETS - 1)) == 0) continue;
+
+        pool.parallelFor(0, n, blockSize, [&](size_t begin, size_t end) {
+            auto& histogram = histograms[begin / blockSize];
+            histogram.fill(0);
+            for (size_t i = begin; i < end; ++i)
+                ++histogram[(src[i].key >> shift) & (BUCKETS - 1)];
+        });
+
+        // Offsets ordered by (digit, block) keep the scatter stable
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < BUCKETS; ++digit) {
+            for (auto& histogram : histograms) {
+                uint32_t count   = histogram[digit];
+                histogram[digit] = offset;
+                offset += count;
+            }
+        }
+
+        pool.parallelFor(0, n, blockSize, [&](size_t begin, size_t end) {
+            auto& histogram = histograms[begin / blockSize];
+            for (size_t i = begin; i < end; ++i)
+                dst[histogram[(src[i].key >> shift) & (BUCKETS - 1)]++] = src[i];
+        });
+
+        std::swap(src, dst);
+    }
+
+    if (src != m_entries.data()) m_entries.swap(m_scratch);
+}
+
+void DrawList::record(VkCommandBuffer commandBuffer, const DrawBindings& bindings)
+{
+    PROFILE_ZONE("DrawList::record");
+
+    // Pre-recorded command buffers re-record the same list lazily, so the
+    // counters describe one recording rather than adding up
+    uint64_t sortNs = m_stats.sortNs;
+    m_stats         = {};
+    m_stats.sortNs  = sortNs;
+
+    VkPipeline boundPipeline         = VK_NULL_HANDLE;
+    VkDescriptorSet boundDescriptors = VK_NULL_HANDLE;
+    VkBuffer boundVertexBuffer       = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer        = VK_NULL_HANDLE;
+    VkDeviceSize boundIndexOffset    = 0;
+
+    for (const auto& entry : m_entries) {
+        const auto& command = m_commands[entry.command];
+        const auto& mesh    = bindings.meshes[command.mesh];
+
+        VkPipeline pipeline = bindings.pipelines[command.pipeline];
+        if (pipeline == VK_NULL_HANDLE) {
+            ++m_stats.drawsSkipped;
+            continue;
+        }
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+            ++m_stats.pipelineBinds;
+        } else {
+            ++m_stats.pipelineBindsElided;
+        }
+
+        VkDescriptorSet descriptors = bindings.materials.empty()
+                                          ? VK_NULL_HANDLE
+                                          : bindings.materials[command.material];
+        if (descriptors != VK_NULL_HANDLE) {
+            if (descriptors != boundDescriptors) {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                        bindings.pipelineLayout, 0, 1, &descriptors, 0, nullptr);
+                boundDescriptors = descriptors;
+                ++m_stats.descriptorBinds;
+            } else {
+                ++m_stats.descriptorBindsElided;
+            }
+        }
+
+        if (mesh.vertexBuffer != VK_NULL_HANDLE) {
+            if (mesh.vertexBuffer != boundVertexBuffer) {
+                VkDeviceSize offset = 0;
+                vkCmdBindVertexBuffers(commandBuffer, MESH_VERTEX_BINDING, 1, &mesh.vertexBuffer,
+                                       &offset);
+                boundVertexBuffer = mesh.vertexBuffer;
+                ++m_stats.vertexBinds;
+            } else {
+                ++m_stats.vertexBindsElided;
+            }
+        }
+
+        if (mesh.indexBuffer != VK_NULL_HANDLE) {
+            if (mesh.indexBuffer != boundIndexBuffer || mesh.indexOffset != boundIndexOffset) {
+                vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, mesh.indexOffset,
+                                     mesh.indexType);
+                boundIndexBuffer = mesh.indexBuffer;
+                boundIndexOffset = mesh.indexOffset;
+                ++m_stats.vertexBinds;
+            } else {
+                ++m_stats.vertexBindsElided;
+            }
+
+            vkCmdDrawIndexed(commandBuffer, command.count, command.instanceCount,
+                             command.firstIndex, command.vertexOffset, command.firstInstance);
+        } else {
+            vkCmdDraw(commandBuffer, command.count, command.instanceCount, command.vertexOffset,
+                      command.firstInstance);
+        }
+        ++m_stats.draws;
+    }
+}
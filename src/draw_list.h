@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+//------------------------------------------------------------------------------
+
+// Sort key layout, most significant first, so sorting groups draws by the
+// most expensive state change:
+//   pass:4 | pipeline:12 | material:16 | mesh:16 | depth:16
+namespace SortKey {
+
+constexpr uint32_t PASS_BITS     = 4;
+constexpr uint32_t PIPELINE_BITS = 12;
+constexpr uint32_t MATERIAL_BITS = 16;
+constexpr uint32_t MESH_BITS     = 16;
+constexpr uint32_t DEPTH_BITS    = 16;
+
+constexpr uint64_t field(uint32_t value, uint32_t bits)
+{
+    return value & ((uint64_t{1} << bits) - 1);
+}
+
+constexpr bool fits(uint32_t value, uint32_t bits)
+{
+    return field(value, bits) == value;
+}
+
+// Each field is masked to its width so an out of range value cannot spill
+// into the one above; DrawList::add() asserts that none is truncated
+constexpr uint64_t make(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh,
+                        uint32_t depth)
+{
+    return field(pass, PASS_BITS) << (PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS) |
+           field(pipeline, PIPELINE_BITS) << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS) |
+           field(material, MATERIAL_BITS) << (MESH_BITS + DEPTH_BITS) |
+           field(mesh, MESH_BITS) << DEPTH_BITS | field(depth, DEPTH_BITS);
+}
+
+// View depth in [0, 1] quantized to DEPTH_BITS; near sorts first
+constexpr uint32_t quantizeDepth(float depth)
+{
+    depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+    return static_cast<uint32_t>(depth * ((1u << DEPTH_BITS) - 1));
+}
+
+} // namespace SortKey
+
+//------------------------------------------------------------------------------
+
+struct DrawCommand
+{
+    uint32_t pass;
+    uint32_t pipeline; // Index into DrawBindings::pipelines
+    uint32_t material; // Index into DrawBindings::materials
+    uint32_t mesh;     // Index into DrawBindings::meshes
+    uint32_t count;    // Index count for indexed meshes, vertex count otherwise
+    uint32_t firstIndex;
+    int32_t vertexOffset; // First vertex for non-indexed draws
+    uint32_t instanceCount;
+    uint32_t firstInstance;
+};
+
+struct MeshBinding
+{
+    VkBuffer vertexBuffer    = VK_NULL_HANDLE; // VK_NULL_HANDLE for shader-generated vertices
+    VkBuffer indexBuffer     = VK_NULL_HANDLE; // VK_NULL_HANDLE for non-indexed draws
+    VkDeviceSize indexOffset = 0;              // Indices may share a buffer with the vertices
+    VkIndexType indexType    = VK_INDEX_TYPE_UINT32;
+};
+
+struct DrawBindings
+{
+    VkPipelineLayout pipelineLayout;
+    std::span<const VkPipeline> pipelines; // VK_NULL_HANDLE skips the draw
+    std::span<const VkDescriptorSet> materials; // VK_NULL_HANDLE binds nothing
+    std::span<const MeshBinding> meshes;
+};
+
+struct DrawStats
+{
+    uint32_t draws                 = 0;
+    uint32_t drawsSkipped          = 0; // Pipeline not ready yet
+    uint32_t pipelineBinds         = 0;
+    uint32_t pipelineBindsElided   = 0;
+    uint32_t descriptorBinds       = 0;
+    uint32_t descriptorBindsElided = 0;
+    uint32_t vertexBinds           = 0;
+    uint32_t vertexBindsElided     = 0;
+    uint64_t sortNs                = 0;
+
+    uint32_t bindsElided() const
+    {
+        return pipelineBindsElided + descriptorBindsElided + vertexBindsElided;
+    }
+
+    void print(std::ostream& out) const;
+};
+
+//------------------------------------------------------------------------------
+
+class DrawList
+{
+  public:
+    static constexpr uint32_t MESH_VERTEX_BINDING = 0;
+
+    void clear();
+
+    // depth is view depth in [0, 1]
+    void add(const DrawCommand& command, float depth);
+
+    // LSD radix sort of the keys, split across the pool for large lists
+    void sort(ThreadPool& pool);
+
+    // Records the sorted draws, skipping binds of state that is already
+    // bound. stats() then describe this recording alone.
+    void record(VkCommandBuffer commandBuffer, const DrawBindings& bindings);
+
+    size_t size() const { return m_commands.size(); }
+    const DrawStats& stats() const { return m_stats; }
+
+  private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t command;
+    };
+
+    void radixSort(ThreadPool& pool);
+
+    std::vector<DrawCommand> m_commands;
+    std::vector<Entry> m_entries;
+    std::vector<Entry> m_scratch;
+    DrawStats m_stats;
+};
@@ -0,0 +1,41 @@
+#include "frame_times.h"
+
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+
+namespace {
+
+void printSummary(std::ostream& out, const char* name, std::vector<uint64_t> samples)
+{
+    out << '\t' << name << ": ";
+    if (samples.empty()) {
+        out << "no samples\n";
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) { return samples[(samples.size() - 1) * p] / 1e6; };
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size() / 1e6;
+
+    out << "mean " << mean << " ms, p50 " << percentile(0.5) << ", p95 " << percentile(0.95)
+        << ", p99 " << percentile(0.99) << ", max " << samples.back() / 1e6 << " ms ("
+        << samples.size() << " frames)\n";
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void FrameTimes::clear()
+{
+    m_cpu.clear();
+    m_gpu.clear();
+}
+
+void FrameTimes::print(std::ostream& out) const
+{
+    out << "Frame times:\n";
+    printSummary(out, "CPU", m_cpu);
+    printSummary(out, "GPU", m_gpu);
+}
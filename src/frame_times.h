@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// CPU and GPU time of every frame since the last clear(), reported as
+// percentiles. GPU times arrive frames later than CPU times, so the two are
+// summarized separately.
+class FrameTimes
+{
+  public:
+    void addCpu(uint64_t ns) { m_cpu.push_back(ns); }
+    void addGpu(uint64_t ns) { m_gpu.push_back(ns); }
+
+    void clear();
+
+    void print(std::ostream& out) const;
+
+  private:
+    std::vector<uint64_t> m_cpu;
+    std::vector<uint64_t> m_gpu;
+};
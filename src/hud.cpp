@@ -0,0 +1,194 @@
+#include "hud.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <ostream>
+
+namespace {
+
+// Printable ASCII from ' ' to '_'; lowercase letters use the uppercase
+// glyphs. Each glyph is 5x7 in the top left of an 8x8 cell, a byte per row
+// from the top, bit 0 leftmost.
+constexpr char FIRST_GLYPH = ' ';
+constexpr char LAST_GLYPH  = '_';
+
+constexpr uint64_t FONT[] = {
+    0x0000000000000000, 0x0004000404040404, 0x0000000000000a0a, 0x000a0a1f0a1f0a0a, //   ! " #
+    0x00040f140e051e04, 0x0018190204081303, 0x0016091502050906, 0x0000000000020404, // $ % & '
+    0x0008040202020408, 0x0002040808080402, 0x000004150e150400, 0x000004041f040400, // ( ) * +
+    0x0002040600000000, 0x000000001f000000, 0x0006060000000000, 0x0000010204081000, // , - . /
+    0x000e11131519110e, 0x000e040404040604, 0x001f02040810110e, 0x000e11100804081f, // 0 1 2 3
+    0x0008081f090a0c08, 0x000e1110100f011f, 0x000e11110f01020c, 0x000202020408101f, // 4 5 6 7
+    0x000e11110e11110e, 0x000608101e11110e, 0x0000060600060600, 0x0002040600060600, // 8 9 : ;
+    0x0008040201020408, 0x0000001f001f0000, 0x0002040810080402, 0x000400040810110e, // < = > ?
+    0x000e15151610110e, 0x001111111f11110e, 0x000f11110f11110f, 0x000e11010101110e, // @ A B C
+    0x0007091111110907, 0x001f01010f01011f, 0x000101010f01011f, 0x001e11111d01110e, // D E F G
+    0x001111111f111111, 0x000e04040404040e, 0x000609080808081c, 0x0011090503050911, // H I J K
+    0x001f010101010101, 0x0011111115151b11, 0x0011111915131111, 0x000e11111111110e, // L M N O
+    0x000101010f11110f, 0x001609151111110e, 0x001109050f11110f, 0x000f10100e01011e, // P Q R S
+    0x000404040404041f, 0x000e111111111111, 0x00040a1111111111, 0x000a151515111111, // T U V W
+    0x0011110a040a1111, 0x000404040a111111, 0x001f01020408101f, 0x000e02020202020e, // X Y Z [
+    0x0000100804020100, 0x000e08080808080e, 0x0000000000110a04, 0x001f000000000000, // \ ] ^ _
+};
+static_assert(std::size(FONT) == LAST_GLYPH - FIRST_GLYPH + 1);
+
+constexpr uint64_t SOLID = UINT64_MAX;
+
+// Pixels per font pixel; a glyph advances 6 font pixels and a line 9
+constexpr float SCALE       = 2.0f;
+constexpr float CELL        = 8.0f * SCALE;
+constexpr float ADVANCE     = 6.0f * SCALE;
+constexpr float LINE_HEIGHT = 9.0f * SCALE;
+
+constexpr float MARGIN  = 8.0f;
+constexpr float PADDING = 6.0f;
+
+constexpr float BAR_WIDTH    = 3.0f;
+constexpr float GRAPH_WIDTH  = Hud::HISTORY * BAR_WIDTH;
+constexpr float GRAPH_HEIGHT = 64.0f;
+constexpr float GRAPH_MS     = 33.3f; // Top of the graph
+constexpr float TARGET_MS    = 16.7f; // Marked with a line
+
+constexpr uint32_t TEXT_LINES = 8;
+
+constexpr uint32_t rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a = 255)
+{
+    return r | g << 8 | b << 16 | a << 24;
+}
+
+constexpr uint32_t BACKGROUND = rgba(0, 0, 0, 160);
+constexpr uint32_t TEXT       = rgba(230, 230, 230);
+constexpr uint32_t CPU        = rgba(255, 160, 40);
+constexpr uint32_t GPU        = rgba(80, 200, 255);
+constexpr uint32_t TARGET     = rgba(140, 140, 140);
+
+uint64_t glyph(char c)
+{
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+    return FONT[c - FIRST_GLYPH];
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void HudStats::print(std::ostream& out) const
+{
+    out << "HUD: " << quads << " quads, build " << buildNs / 1000.0 << " us\n";
+}
+
+//------------------------------------------------------------------------------
+
+void Hud::History::add(uint64_t ns)
+{
+    samples[next] = ns;
+    next          = (next + 1) % HISTORY;
+    count         = std::min(count + 1, HISTORY);
+}
+
+uint64_t Hud::History::at(uint32_t age) const
+{
+    return samples[(next + HISTORY - 1 - age) % HISTORY];
+}
+
+uint32_t Hud::build(const HudCounters& counters, HudQuad* out)
+{
+    PROFILE_ZONE("Hud::build");
+
+    uint64_t start = Profiler::now();
+    m_out          = out;
+    m_quads        = 0;
+
+    // Fixed layout, so the background goes first without measuring the text
+    float x = MARGIN + PADDING;
+    float y = MARGIN + PADDING;
+    rect(MARGIN, MARGIN, GRAPH_WIDTH + 2 * PADDING,
+         GRAPH_HEIGHT + TEXT_LINES * LINE_HEIGHT + 3 * PADDING, BACKGROUND);
+
+    char line[64];
+    text(x, y, TEXT, "Frame ms p50   p95   p99");
+    percentiles(x, y + LINE_HEIGHT, CPU, "CPU", m_cpu);
+    percentiles(x, y + 2 * LINE_HEIGHT, GPU, "GPU", m_gpu);
+    y += 3 * LINE_HEIGHT;
+
+    graph(x, y);
+    y += GRAPH_HEIGHT + PADDING;
+
+    std::snprintf(line, sizeof(line), "Draws %u  instances %llu", counters.draws,
+                  static_cast<unsigned long long>(counters.instances));
+    text(x, y, TEXT, line);
+    std::snprintf(line, sizeof(line), "Triangles %llu",
+                  static_cast<unsigned long long>(counters.triangles));
+    text(x, y + LINE_HEIGHT, TEXT, line);
+    std::snprintf(line, sizeof(line), "Swap chains rebuilt %llu",
+                  static_cast<unsigned long long>(counters.swapChainRecreations));
+    text(x, y + 2 * LINE_HEIGHT, TEXT, line);
+    std::snprintf(line, sizeof(line), "Memory %llu / %llu MiB",
+                  static_cast<unsigned long long>(counters.memoryUsage >> 20),
+                  static_cast<unsigned long long>(counters.memoryBudget >> 20));
+    text(x, y + 3 * LINE_HEIGHT, TEXT, line);
+    std::snprintf(line, sizeof(line), "HUD %.1f us, %u quads", m_stats.buildNs / 1000.0,
+                  m_stats.quads);
+    text(x, y + 4 * LINE_HEIGHT, TEXT, line);
+
+    m_stats.quads   = m_quads;
+    m_stats.buildNs = Profiler::now() - start;
+    return m_quads;
+}
+
+void Hud::text(float x, float y, uint32_t color, const char* str)
+{
+    for (; *str; ++str, x += ADVANCE) {
+        if (*str == ' ' || m_quads == MAX_QUADS) continue;
+
+        uint64_t bits    = glyph(*str);
+        m_out[m_quads++] = {{x, y, CELL, CELL}, {uint32_t(bits), uint32_t(bits >> 32)}, color};
+    }
+}
+
+void Hud::rect(float x, float y, float width, float height, uint32_t color)
+{
+    if (m_quads == MAX_QUADS) return;
+    m_out[m_quads++] = {{x, y, width, height}, {uint32_t(SOLID), uint32_t(SOLID >> 32)}, color};
+}
+
+void Hud::percentiles(float x, float y, uint32_t color, const char* name, const History& history)
+{
+    char line[64];
+    if (history.count == 0) {
+        std::snprintf(line, sizeof(line), "%-6s    --    --    --", name);
+        text(x, y, color, line);
+        return;
+    }
+
+    m_sorted.assign(history.samples.begin(), history.samples.begin() + history.count);
+    std::sort(m_sorted.begin(), m_sorted.end());
+    auto percentile = [&](double p) { return m_sorted[(m_sorted.size() - 1) * p] / 1e6; };
+
+    std::snprintf(line, sizeof(line), "%-6s %5.2f %5.2f %5.2f", name, percentile(0.5),
+                  percentile(0.95), percentile(0.99));
+    text(x, y, color, line);
+}
+
+// Newest frame on the right; GPU bars are drawn thinner over the CPU ones
+void Hud::graph(float x, float y)
+{
+    float bottom = y + GRAPH_HEIGHT;
+    auto height  = [](uint64_t ns) { return std::min(ns / 1e6f / GRAPH_MS, 1.0f) * GRAPH_HEIGHT; };
+
+    for (uint32_t age = 0; age < m_cpu.count; ++age) {
+        float h = height(m_cpu.at(age));
+        rect(x + GRAPH_WIDTH - (age + 1) * BAR_WIDTH, bottom - h, BAR_WIDTH, h, CPU);
+    }
+    for (uint32_t age = 0; age < m_gpu.count; ++age) {
+        float h = height(m_gpu.at(age));
+        rect(x + GRAPH_WIDTH - (age + 1) * BAR_WIDTH + 1.0f, bottom - h, 1.0f, h, GPU);
+    }
+
+    float target = bottom - TARGET_MS / GRAPH_MS * GRAPH_HEIGHT;
+    rect(x, target, GRAPH_WIDTH, 1.0f, TARGET);
+}
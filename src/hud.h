@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// One instanced quad of the overlay. Text and graph bars are the same thing:
+// a bar is a glyph with every bit set.
+struct HudQuad
+{
+    float rect[4];     // x, y, width, height in pixels from the top left
+    uint32_t glyph[2]; // 8x8 bitmap, a byte per row, bit 0 leftmost
+    uint32_t color;    // RGBA8
+};
+
+// What the application reports each frame
+struct HudCounters
+{
+    uint32_t draws; // In the draw list, which every view records
+    uint64_t instances;
+    uint64_t triangles;
+    uint64_t swapChainRecreations;
+    uint64_t memoryUsage; // Device-local heaps, bytes
+    uint64_t memoryBudget;
+};
+
+struct HudStats
+{
+    uint32_t quads   = 0;
+    uint64_t buildNs = 0;
+
+    void print(std::ostream& out) const;
+};
+
+// Performance overlay: a rolling CPU/GPU frame-time graph, percentiles and
+// counters, laid out on the CPU as quads for a single instanced draw.
+// Glyphs come from a built-in 5x7 font passed along with each quad, so
+// drawing needs no texture or descriptor set.
+class Hud
+{
+  public:
+    static constexpr uint32_t MAX_QUADS = 1024;
+    static constexpr uint32_t HISTORY   = 120; // Frames in the graph
+
+    void addCpu(uint64_t ns) { m_cpu.add(ns); }
+    void addGpu(uint64_t ns) { m_gpu.add(ns); }
+
+    // Writes front to back into out, which may be write-combined memory, and
+    // returns the quad count. The overlay shows the previous build's cost.
+    uint32_t build(const HudCounters& counters, HudQuad* out);
+
+    const HudStats& stats() const { return m_stats; }
+
+  private:
+    struct History
+    {
+        std::array<uint64_t, HISTORY> samples = {};
+        uint32_t next                         = 0;
+        uint32_t count                        = 0;
+
+        void add(uint64_t ns);
+        uint64_t at(uint32_t age) const; // 0 is the newest
+    };
+
+    void text(float x, float y, uint32_t color, const char* str);
+    void rect(float x, float y, float width, float height, uint32_t color);
+    void percentiles(float x, float y, uint32_t color, const char* name, const History& history);
+    void graph(float x, float y);
+
+    HudQuad* m_out   = nullptr;
+    uint32_t m_quads = 0;
+
+    History m_cpu;
+    History m_gpu;
+    std::vector<uint64_t> m_sorted; // Scratch for percentiles
+    HudStats m_stats;
+};
@@ -0,0 +1,104 @@
+#include "lod.h"
+
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <ostream>
+#include <utility>
+
+namespace {
+
+// Keeps an instance at the eye from dividing by zero
+constexpr float MIN_DISTANCE = 1e-3f;
+
+// Largest axis scale of an affine matrix
+float maxScale(const Mat4& world)
+{
+    float largest = 0.0f;
+    for (int col = 0; col < 3; ++col) {
+        const float* c = &world.m[col * 4];
+        largest        = std::max(largest, c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+    }
+    return std::sqrt(largest);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void LodStats::print(std::ostream& out) const
+{
+    out << "LOD: " << trianglesSubmitted << " triangles (" << trianglesFullDetail
+        << " at full detail), select " << selectNs / 1000.0 << " us, instances per level";
+    for (uint32_t count : instances)
+        out << ' ' << count;
+    out << '\n';
+}
+
+//------------------------------------------------------------------------------
+
+void LodSelector::setInstances(std::vector<TransformSystem::NodeId> instances)
+{
+    m_instances = std::move(instances);
+    m_levels.assign(m_instances.size(), 0);
+    buildRuns();
+}
+
+bool LodSelector::select(ThreadPool& pool, const TransformSystem& transforms,
+                         std::span<const MeshFormat::Lod> lods, const LodView& view)
+{
+    PROFILE_ZONE("LodSelector::select");
+
+    uint64_t start = Profiler::now();
+    std::atomic<bool> changed{false};
+
+    // Projected error in pixels is error * scale * pixelsPerUnit / distance
+    pool.parallelFor(0, m_instances.size(), SELECT_GRAIN, [&](size_t begin, size_t end) {
+        bool chunkChanged = false;
+        for (size_t i = begin; i < end; ++i) {
+            const Mat4& world = transforms.worldMatrix(m_instances[i]);
+
+            float dx       = world.m[12] - view.eye[0];
+            float dy       = world.m[13] - view.eye[1];
+            float dz       = world.m[14] - view.eye[2];
+            float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), MIN_DISTANCE);
+            float maxError = view.maxPixelError * distance / (maxScale(world) * view.pixelsPerUnit);
+
+            // Errors grow with the level, so stop at the first one too coarse
+            uint8_t level = 0;
+            while (level + 1u < lods.size() && lods[level + 1].error <= maxError)
+                ++level;
+
+            if (m_levels[i] != level) {
+                m_levels[i]  = level;
+                chunkChanged = true;
+            }
+        }
+        if (chunkChanged) changed.store(true, std::memory_order_relaxed);
+    });
+
+    if (changed) buildRuns();
+
+    m_stats = {};
+    for (const Run& run : m_runs) {
+        m_stats.trianglesSubmitted += uint64_t{lods[run.lod].indexCount / 3} * run.instanceCount;
+        m_stats.instances[run.lod] += run.instanceCount;
+    }
+    m_stats.trianglesFullDetail = uint64_t{lods[0].indexCount / 3} * m_instances.size();
+    m_stats.selectNs            = Profiler::now() - start;
+    return changed;
+}
+
+void LodSelector::buildRuns()
+{
+    m_runs.clear();
+    for (uint32_t i = 0; i < m_levels.size(); ++i) {
+        if (!m_runs.empty() && m_runs.back().lod == m_levels[i])
+            ++m_runs.back().instanceCount;
+        else
+            m_runs.push_back({m_levels[i], i, 1});
+    }
+}
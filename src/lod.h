@@ -0,0 +1,67 @@
+#pragma once
+
+#include "mesh_format.h"
+#include "transforms.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+//------------------------------------------------------------------------------
+
+struct LodStats
+{
+    uint64_t trianglesSubmitted              = 0;
+    uint64_t trianglesFullDetail             = 0; // Had every instance used level 0
+    uint32_t instances[MeshFormat::MAX_LODS] = {}; // Per level
+    uint64_t selectNs                        = 0;
+
+    void print(std::ostream& out) const;
+};
+
+struct LodView
+{
+    float eye[3];
+    float pixelsPerUnit; // Viewport height / (2 tan(fovY / 2))
+    float maxPixelError;
+};
+
+// Level of detail per instance of one mesh. Each instance gets the coarsest
+// level whose error, scaled by its world matrix and projected at its
+// distance from the eye, stays within maxPixelError. Instances keep their
+// slot in the instance buffer, so consecutive instances on the same level
+// are drawn together as one run.
+class LodSelector
+{
+  public:
+    struct Run
+    {
+        uint32_t lod;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // instances[i] is the node written to instance slot i
+    void setInstances(std::vector<TransformSystem::NodeId> instances);
+
+    // Runs on the pool. Reads the world matrices of the last
+    // TransformSystem::update(). Returns true if runs() changed.
+    bool select(ThreadPool& pool, const TransformSystem& transforms,
+                std::span<const MeshFormat::Lod> lods, const LodView& view);
+
+    const std::vector<Run>& runs() const { return m_runs; }
+    const LodStats& stats() const { return m_stats; }
+
+  private:
+    void buildRuns();
+
+    static constexpr size_t SELECT_GRAIN = 4096;
+
+    std::vector<TransformSystem::NodeId> m_instances;
+    std::vector<uint8_t> m_levels; // Per instance
+    std::vector<Run> m_runs;
+    LodStats m_stats;
+};
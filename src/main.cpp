@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <array>
 #include <bits/stdint-uintn.h>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -12,12 +13,27 @@
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <set>
 #include <stdexcept>
 #include <vector>
 
+#include "capture.h"
+#include "draw_list.h"
+#include "frame_times.h"
+#include "hud.h"
+#include "lod.h"
+#include "memory_stats.h"
+#include "mesh_file.h"
+#include "pipeline_compiler.h"
+#include "profiler.h"
+#include "render_graph.h"
+#include "thread_pool.h"
+#include "transforms.h"
+
 const std::vector<const char*> g_deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+const std::vector<const char*> g_optionalDeviceExtensions = {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME};
 const std::vector<const char*> g_validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
 #ifdef NDEBUG
@@ -36,7 +52,10 @@ struct QueueFamilyIndices
     bool isComplete() { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
 
-QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
+// All views present with one vkQueuePresentKHR, so the present family must
+// support every surface
+QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device,
+                                     const std::vector<VkSurfaceKHR>& surfaces)
 {
     QueueFamilyIndices indices;
 
@@ -51,8 +70,12 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
 
         if (it->queueFlags & VK_QUEUE_GRAPHICS_BIT) indices.graphicsFamily = i;
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        bool presentSupport = true;
+        for (VkSurfaceKHR surface : surfaces) {
+            VkBool32 supported = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &supported);
+            presentSupport = presentSupport && supported;
+        }
         if (presentSupport) indices.presentFamily = i;
 
         if (indices.isComplete()) break;
@@ -98,6 +121,23 @@ SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurface
 
 //------------------------------------------------------------------------------
 
+std::set<std::string> enumerateDeviceExtensions(VkPhysicalDevice device)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                         availableExtensions.data());
+
+    std::set<std::string> names;
+    for (const auto& extension : availableExtensions)
+        names.insert(extension.extensionName);
+
+    return names;
+}
+
+//------------------------------------------------------------------------------
+
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
 {
     for (const auto& availableFormat : availableFormats) {
@@ -110,10 +150,29 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
     return availableFormats.at(0);
 }
 
+// Views share pipelines, so every swap chain must have the same format
+VkSurfaceFormatKHR findSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats,
+                                     VkFormat format)
+{
+    for (const auto& availableFormat : availableFormats) {
+        if (availableFormat.format == format) return availableFormat;
+    }
+
+    throw std::runtime_error{"failed to find surface format shared by all views!"};
+}
+
 //------------------------------------------------------------------------------
 
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+// Unthrottled prefers IMMEDIATE, for replays that run as fast as possible
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+                                       bool unthrottled)
 {
+    if (unthrottled) {
+        for (const auto& availablePresentMode : availablePresentModes) {
+            if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) return availablePresentMode;
+        }
+    }
+
     for (const auto& availablePresentMode : availablePresentModes) {
         if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
             return availablePresentMode;
@@ -125,15 +184,13 @@ VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& avai
 
 //------------------------------------------------------------------------------
 
-VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window)
+VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities,
+                            VkExtent2D framebufferExtent)
 {
     if (capabilities.currentExtent.width != UINT32_MAX) {
         return capabilities.currentExtent;
     } else {
-        int width  = 0;
-        int height = 0;
-        glfwGetFramebufferSize(window, &width, &height);
-        VkExtent2D actualExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        VkExtent2D actualExtent = framebufferExtent;
 
         actualExtent.width  = std::clamp(actualExtent.width, capabilities.minImageExtent.width,
                                          capabilities.maxImageExtent.width);
@@ -165,6 +222,7 @@ std::vector<std::byte> readFile(const std::string& filename)
 //------------------------------------------------------------------------------
 
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 //------------------------------------------------------------------------------
 
@@ -173,45 +231,102 @@ class HelloTriangleApplication
   public:
     void run()
     {
+        Profiler::setEnabled(std::getenv("VT_PROFILE") != nullptr);
+        m_staticCommands = std::getenv("VT_STATIC_COMMANDS") != nullptr;
+        m_headless       = m_replay || std::getenv("VT_HEADLESS") != nullptr;
+        m_printStats     = std::getenv("VT_STATS") != nullptr;
+        m_hudEnabled     = std::getenv("VT_HUD") != nullptr;
+
         initWindow();
+        if (const char* filename = std::getenv("VT_CAPTURE"))
+            m_capture.open(filename, m_views.size());
         initVulkan();
         mainLoop();
         cleanup();
     }
 
+    // Plays a VT_CAPTURE trace back on headless views, as fast as they
+    // present, and reports frame times at the end. Nothing in the replay
+    // depends on wall-clock time, so runs are comparable.
+    void replay(const std::string& filename)
+    {
+        m_replay = std::make_unique<CaptureReader>(filename);
+        run();
+    }
+
+    void onFramebufferResized(GLFWwindow* window)
+    {
+        for (auto& view : m_views) {
+            if (view.window == window) view.framebufferResized = true;
+        }
+    }
+
   private:
+    struct View;
+
+    // VT_VIEWS windows, or none when headless. A replay has the captured
+    // number of views.
     void initWindow()
     {
+        const char* viewsEnv = std::getenv("VT_VIEWS");
+        m_views.resize(m_replay ? m_replay->header().viewCount
+                                : std::max(viewsEnv ? std::atoi(viewsEnv) : 1, 1));
+        for (uint32_t i = 0; i < m_views.size(); ++i)
+            m_views[i].id = i;
+
+        if (m_headless) return;
+
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
         glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-        m_window = glfwCreateWindow(800, 600, "Vulkan", nullptr, nullptr);
+        for (auto& view : m_views) {
+            std::string title = "Vulkan";
+            if (m_views.size() > 1) title += " (view " + std::to_string(view.id) + ')';
+
+            view.window =
+                glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, title.c_str(), nullptr, nullptr);
 
-        glfwSetWindowUserPointer(m_window, this);
-        glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
+            glfwSetWindowUserPointer(view.window, this);
+            glfwSetFramebufferSizeCallback(view.window, framebufferResizeCallback);
+            glfwSetKeyCallback(view.window, keyCallback);
+        }
     }
 
     void initVulkan()
     {
+        PROFILE_ZONE("initVulkan");
+
         createInstance();
-        createSurface();
+        createSurfaces();
         pickPhysicalDevice();
         createLogicalDevice();
-        createSwapChain();
-        createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
+        for (auto& view : m_views) {
+            createSwapChain(view);
+            createImageViews(view);
+            createRenderGraph(view);
+        }
+        createPipelineLayout();
+        createGraphicsPipelines();
         createCommandPool();
         createCommandBuffers();
+        for (auto& view : m_views)
+            createStaticCommandBuffers(view);
+        createMeshes();
+        if (!m_replay) createScene();
+        createInstanceBuffers();
+        createHudBuffers();
         createSemaphores();
         createFences();
+        createQueryPool();
+        calibrateGpuClock();
     }
 
     void createInstance()
     {
+        PROFILE_ZONE("createInstance");
+
         if (enableValidationLayers && !checkValidationLayerSupport())
             throw std::runtime_error{"validation layers requested but not available!"};
 
@@ -225,16 +340,22 @@ class HelloTriangleApplication
 
         printAvailableExtensions();
 
-        uint32_t glfwExtensionsCount = 0;
-        const char** glfwExtensions;
+        std::vector<const char*> extensions;
+        if (m_headless) {
+            extensions = {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+        } else {
+            uint32_t glfwExtensionsCount = 0;
+            const char** glfwExtensions;
 
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionsCount);
+        }
 
         VkInstanceCreateInfo createInfo    = {};
         createInfo.sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo        = &appInfo;
-        createInfo.enabledExtensionCount   = glfwExtensionsCount;
-        createInfo.ppEnabledExtensionNames = glfwExtensions;
+        createInfo.enabledExtensionCount   = extensions.size();
+        createInfo.ppEnabledExtensionNames = extensions.data();
         if (enableValidationLayers) {
             createInfo.enabledLayerCount   = g_validationLayers.size();
             createInfo.ppEnabledLayerNames = g_validationLayers.data();
@@ -245,10 +366,39 @@ class HelloTriangleApplication
             throw std::runtime_error{"failed to create instance!"};
     }
 
-    void createSurface()
+    // Headless surfaces have no window system behind them; presenting to
+    // them only cycles the swap chain images
+    void createSurfaces()
     {
-        if (glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
-            throw std::runtime_error{"failed to create window surface!"};
+        PROFILE_ZONE("createSurfaces");
+
+        PFN_vkCreateHeadlessSurfaceEXT createHeadlessSurface = nullptr;
+        if (m_headless) {
+            createHeadlessSurface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+                vkGetInstanceProcAddr(m_instance, "vkCreateHeadlessSurfaceEXT"));
+            if (!createHeadlessSurface)
+                throw std::runtime_error{"failed to load vkCreateHeadlessSurfaceEXT!"};
+        }
+
+        for (auto& view : m_views) {
+            VkResult result;
+            if (m_headless) {
+                VkHeadlessSurfaceCreateInfoEXT createInfo = {};
+                createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+                result = createHeadlessSurface(m_instance, &createInfo, nullptr, &view.surface);
+            } else {
+                result = glfwCreateWindowSurface(m_instance, view.window, nullptr, &view.surface);
+            }
+            if (result != VK_SUCCESS) throw std::runtime_error{"failed to create window surface!"};
+        }
+    }
+
+    std::vector<VkSurfaceKHR> surfaces() const
+    {
+        std::vector<VkSurfaceKHR> surfaces;
+        for (const auto& view : m_views)
+            surfaces.push_back(view.surface);
+        return surfaces;
     }
 
     void printAvailableExtensions()
@@ -288,6 +438,8 @@ class HelloTriangleApplication
 
     void pickPhysicalDevice()
     {
+        PROFILE_ZONE("pickPhysicalDevice");
+
         uint32_t deviceCount = 0;
         vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
 
@@ -308,14 +460,17 @@ class HelloTriangleApplication
 
     bool isDeviceSuitable(VkPhysicalDevice device)
     {
-        QueueFamilyIndices indices = findQueueFamilies(device, m_surface);
+        QueueFamilyIndices indices = findQueueFamilies(device, surfaces());
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
         bool swapChainAdequate   = false;
         if (extensionsSupported) {
-            auto swapChainSupport = querySwapChainSupport(device, m_surface);
             swapChainAdequate =
-                !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+                std::all_of(m_views.cbegin(), m_views.cend(), [&](const View& view) {
+                    auto swapChainSupport = querySwapChainSupport(device, view.surface);
+                    return !swapChainSupport.formats.empty() &&
+                           !swapChainSupport.presentModes.empty();
+                });
         }
 
         return indices.isComplete() && extensionsSupported && swapChainAdequate;
@@ -323,25 +478,17 @@ class HelloTriangleApplication
 
     bool checkDeviceExtensionSupport(VkPhysicalDevice device)
     {
-        uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
-                                             availableExtensions.data());
-
-        std::set<std::string> requiredExtensions(g_deviceExtensions.cbegin(),
-                                                 g_deviceExtensions.cend());
-
-        for (const auto& extension : availableExtensions) {
-            requiredExtensions.erase(extension.extensionName);
-        }
+        auto availableExtensions = enumerateDeviceExtensions(device);
 
-        return requiredExtensions.empty();
+        return std::all_of(g_deviceExtensions.cbegin(), g_deviceExtensions.cend(),
+                           [&](const char* name) { return availableExtensions.count(name); });
     }
 
     void createLogicalDevice()
     {
-        QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice, m_surface);
+        PROFILE_ZONE("createLogicalDevice");
+
+        QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice, surfaces());
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
@@ -359,29 +506,51 @@ class HelloTriangleApplication
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
 
+        auto availableExtensions = enumerateDeviceExtensions(m_physicalDevice);
+        std::vector<const char*> enabledExtensions(g_deviceExtensions);
+        for (const char* name : g_optionalDeviceExtensions) {
+            if (availableExtensions.count(name)) enabledExtensions.push_back(name);
+        }
+
         VkDeviceCreateInfo createInfo      = {};
         createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.pQueueCreateInfos       = queueCreateInfos.data();
         createInfo.queueCreateInfoCount    = queueCreateInfos.size();
         createInfo.pEnabledFeatures        = &deviceFeatures;
-        createInfo.ppEnabledExtensionNames = g_deviceExtensions.data();
-        createInfo.enabledExtensionCount   = g_deviceExtensions.size();
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+        createInfo.enabledExtensionCount   = enabledExtensions.size();
         createInfo.enabledLayerCount       = 0;
 
         if (vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device) != VK_SUCCESS)
             throw std::runtime_error{"failed to create logical device!"};
 
+        m_memoryStats.init(m_physicalDevice,
+                           availableExtensions.count(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+        // A fraction of the budget; unparsable values keep the default
+        if (const char* threshold = std::getenv("VT_MEMORY_PRESSURE")) {
+            char* end      = nullptr;
+            float fraction = std::strtof(threshold, &end);
+            if (end != threshold)
+                m_memoryStats.setPressureThreshold(std::clamp(fraction, 0.0f, 1.0f));
+        }
+
         vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
         vkGetDeviceQueue(m_device, indices.presentFamily.value(), 0, &m_presentQueue);
     }
 
-    void createSwapChain()
+    // The first view picks the format, the others must match it
+    void createSwapChain(View& view)
     {
-        auto swapChainSupport = querySwapChainSupport(m_physicalDevice, m_surface);
-        auto surfaceFormat    = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        auto presentMode      = chooseSwapPresentMode(swapChainSupport.presentModes);
-        auto extent           = chooseSwapExtent(swapChainSupport.capabilities, m_window);
-        uint32_t imageCount   = swapChainSupport.capabilities.minImageCount + 1;
+        PROFILE_ZONE("createSwapChain");
+
+        auto swapChainSupport = querySwapChainSupport(m_physicalDevice, view.surface);
+        auto surfaceFormat =
+            view.id == 0 ? chooseSwapSurfaceFormat(swapChainSupport.formats)
+                         : findSurfaceFormat(swapChainSupport.formats, m_views[0].imageFormat);
+        auto presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, bool(m_replay));
+        auto framebuffer    = framebufferExtent(view);
+        auto extent         = chooseSwapExtent(swapChainSupport.capabilities, framebuffer);
+        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
 
         if (swapChainSupport.capabilities.maxImageCount > 0) {
             imageCount = std::min(imageCount, swapChainSupport.capabilities.maxImageCount);
@@ -389,7 +558,7 @@ class HelloTriangleApplication
 
         VkSwapchainCreateInfoKHR createInfo = {};
         createInfo.sType                    = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        createInfo.surface                  = m_surface;
+        createInfo.surface                  = view.surface;
         createInfo.minImageCount            = imageCount;
         createInfo.imageFormat              = surfaceFormat.format;
         createInfo.imageColorSpace          = surfaceFormat.colorSpace;
@@ -397,7 +566,7 @@ class HelloTriangleApplication
         createInfo.imageArrayLayers         = 1;
         createInfo.imageUsage               = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-        QueueFamilyIndices indices    = findQueueFamilies(m_physicalDevice, m_surface);
+        QueueFamilyIndices indices    = findQueueFamilies(m_physicalDevice, surfaces());
         uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(),
                                          indices.presentFamily.value()};
 
@@ -417,28 +586,44 @@ class HelloTriangleApplication
         createInfo.clipped        = VK_TRUE;
         createInfo.oldSwapchain   = VK_NULL_HANDLE;
 
-        if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS) {
+        if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &view.swapChain) != VK_SUCCESS) {
             throw std::runtime_error{"failed to create swap chain!"};
         }
 
-        vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, nullptr);
-        m_swapChainImages.resize(imageCount);
-        vkGetSwapchainImagesKHR(m_device, m_swapChain, &imageCount, m_swapChainImages.data());
+        vkGetSwapchainImagesKHR(m_device, view.swapChain, &imageCount, nullptr);
+        view.images.resize(imageCount);
+        vkGetSwapchainImagesKHR(m_device, view.swapChain, &imageCount, view.images.data());
 
-        m_swapChainImageFormat = surfaceFormat.format;
-        m_swapChainExtent      = extent;
+        view.imageFormat = surfaceFormat.format;
+        view.extent      = extent;
+
+        // Covers recreation too, so a replay resizes on the same frame
+        m_capture.resize(view.id, view.extent);
     }
 
-    void createImageViews()
+    // Only used when the surface leaves the extent to the application
+    VkExtent2D framebufferExtent(const View& view) const
     {
-        m_swapChainImageViews.resize(m_swapChainImages.size());
+        if (!view.window) return view.headlessExtent;
 
-        for (size_t i = 0u; i < m_swapChainImages.size(); ++i) {
+        int width  = 0;
+        int height = 0;
+        glfwGetFramebufferSize(view.window, &width, &height);
+        return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    }
+
+    void createImageViews(View& view)
+    {
+        PROFILE_ZONE("createImageViews");
+
+        view.imageViews.resize(view.images.size());
+
+        for (size_t i = 0u; i < view.images.size(); ++i) {
             VkImageViewCreateInfo createInfo           = {};
             createInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            createInfo.image                           = m_swapChainImages[i];
+            createInfo.image                           = view.images[i];
             createInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
-            createInfo.format                          = m_swapChainImageFormat;
+            createInfo.format                          = view.imageFormat;
             createInfo.components.r                    = VK_COMPONENT_SWIZZLE_IDENTITY;
             createInfo.components.g                    = VK_COMPONENT_SWIZZLE_IDENTITY;
             createInfo.components.b                    = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -449,59 +634,139 @@ class HelloTriangleApplication
             createInfo.subresourceRange.baseArrayLayer = 0;
             createInfo.subresourceRange.layerCount     = 1;
 
-            if (vkCreateImageView(m_device, &createInfo, nullptr, &m_swapChainImageViews[i]) !=
+            if (vkCreateImageView(m_device, &createInfo, nullptr, &view.imageViews[i]) !=
                 VK_SUCCESS) {
                 throw std::runtime_error{"failed to create image view!"};
             }
         }
     }
 
-    void createRenderPass()
+    // The swap chain image is imported into the graph, which transitions it
+    // to PRESENT_SRC at the end of the frame. Depth only lives inside the
+    // scene pass. Each view has its own graph, so transients are sized to
+    // its swap chain.
+    void createRenderGraph(View& view)
     {
-        VkAttachmentDescription colorAttachment = {};
-        colorAttachment.format                  = m_swapChainImageFormat;
-        colorAttachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp                  = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp                 = VK_ATTACHMENT_STORE_OP_STORE;
-        colorAttachment.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout             = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        PROFILE_ZONE("createRenderGraph");
+
+        RenderGraph::Allocator allocator = {
+            [this](const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) {
+                return allocateMemory(requirements, properties);
+            },
+            [this](VkDeviceMemory memory) { freeMemory(memory); }};
+        RenderGraph& graph = view.renderGraph;
+        graph.init(m_device, std::move(allocator));
+
+        // The acquire semaphore is waited for at color attachment output
+        view.backbuffer = graph.importImage("backbuffer", view.imageFormat,
+                                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        auto depth     = graph.createImage("depth", findDepthFormat(), VK_IMAGE_ASPECT_DEPTH_BIT);
+        auto instances = graph.importBuffer("instances");
+
+        VkClearValue clearColor = {};
+        clearColor.color        = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        VkClearValue clearDepth = {};
+        clearDepth.depthStencil = {1.0f, 0};
+
+        auto scene = graph.addPass("scene", [this, id = view.id](VkCommandBuffer commandBuffer) {
+            recordScenePass(commandBuffer, m_views[id]);
+        });
+        graph.attach(scene, view.backbuffer, clearColor);
+        graph.attach(scene, depth, clearDepth);
+        graph.read(scene, instances, RenderGraph::Usage::VertexBuffer);
+
+        graph.compile();
+
+        // Pipelines only depend on attachment formats, which all views
+        // share, so the first view's pass stays valid for every graph
+        if (view.id == 0) m_renderPass = graph.renderPass(scene);
+
+        allocateRenderGraph(view);
+    }
 
-        VkAttachmentReference colorAttachmentRef = {};
-        colorAttachmentRef.attachment            = 0;
-        colorAttachmentRef.layout                = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    void allocateRenderGraph(View& view)
+    {
+        view.renderGraph.setImportedImages(view.backbuffer, view.images, view.imageViews);
+        view.renderGraph.allocate(view.extent);
+
+        if (std::getenv("VT_DUMP_GRAPH")) {
+            std::cout << "View " << view.id << ":\n";
+            view.renderGraph.dump(std::cout);
+        }
+    }
+
+    VkFormat findDepthFormat()
+    {
+        for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT,
+                                VK_FORMAT_D24_UNORM_S8_UINT}) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                return format;
+        }
+
+        throw std::runtime_error{"failed to find supported depth format!"};
+    }
 
-        VkSubpassDescription subpass = {};
-        subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        subpass.colorAttachmentCount = 1;
-        subpass.pColorAttachments    = &colorAttachmentRef;
+    void createPipelineLayout()
+    {
+        PROFILE_ZONE("createPipelineLayout");
+
+        VkPushConstantRange cameraRange = {};
+        cameraRange.stageFlags          = VK_SHADER_STAGE_VERTEX_BIT;
+        cameraRange.offset              = 0;
+        cameraRange.size                = sizeof(Mat4);
 
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass          = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass          = 0;
-        dependency.srcStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask       = 0;
-        dependency.dstStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &cameraRange;
 
-        VkRenderPassCreateInfo renderPassInfo = {};
-        renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount        = 1;
-        renderPassInfo.pAttachments           = &colorAttachment;
-        renderPassInfo.subpassCount           = 1;
-        renderPassInfo.pSubpasses             = &subpass;
-        renderPassInfo.dependencyCount        = 1;
-        renderPassInfo.pDependencies          = &dependency;
+        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) !=
+            VK_SUCCESS)
+            throw std::runtime_error{"failed to create pipeline layout!"};
+    }
 
-        if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
-            throw std::runtime_error{"failed to create render pass!"};
+    // Pipelines needed for the first frame are built up front; the lit mesh
+    // pipeline compiles in the background and the unlit one stands in for it
+    void createGraphicsPipelines()
+    {
+        PROFILE_ZONE("createGraphicsPipelines");
+
+        m_pipelineCompiler.init(m_device, m_physicalDevice, MAX_FRAMES_IN_FLIGHT,
+                                [this](VkPipelineCache cache, const PipelineDesc& desc) {
+                                    return createGraphicsPipeline(cache, desc);
+                                });
+        // Polling would put stat() calls in timed frames and could swap
+        // pipelines mid-replay
+        m_pipelineCompiler.setWatchShaders(!m_replay);
+        // The driver keeps the cache in host memory, so any heap's pressure
+        // is reason enough; it is on disk for the next run anyway
+        m_memoryStats.addCacheTrimmer([this](uint32_t) { m_pipelineCompiler.trimCache(); });
+
+        if (m_replay) return; // The capture lists its pipelines
+
+        PipelineDesc triangle = {"shaders/vert.spv", "shaders/frag.spv", false};
+        PipelineDesc unlit    = {"shaders/mesh_vert.spv", "shaders/frag.spv", true};
+        PipelineDesc lit      = {"shaders/mesh_vert.spv", "shaders/mesh_frag.spv", true};
+        PipelineDesc hud      = {"shaders/hud_vert.spv", "shaders/hud_frag.spv", false, true};
+        m_capture.pipeline(m_pipelineCompiler.compileNow(triangle), triangle);
+        m_capture.pipeline(m_pipelineCompiler.compileNow(unlit), unlit);
+        m_capture.pipeline(m_pipelineCompiler.request(lit, MESH_FALLBACK_PIPELINE), lit);
+        m_capture.pipeline(m_pipelineCompiler.compileNow(hud), hud);
     }
 
-    void createGraphicsPipeline()
+    // Runs on PipelineCompiler threads, so only reads state that is fixed
+    // after init. desc.meshVertices adds MeshFormat::Vertex attributes at
+    // DrawList::MESH_VERTEX_BINDING; without them the shader makes its own.
+    // desc.overlay replaces the instance matrices with HudQuads.
+    VkPipeline createGraphicsPipeline(VkPipelineCache cache, const PipelineDesc& desc)
     {
-        auto vertShaderCode = readFile("shaders/vert.spv");
-        auto fragShaderCode = readFile("shaders/frag.spv");
+        bool meshVertices   = desc.meshVertices;
+        bool overlay        = desc.overlay;
+        auto vertShaderCode = readFile(desc.vertexShader);
+        auto fragShaderCode = readFile(desc.fragmentShader);
 
         VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
         VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -520,34 +785,69 @@ class HelloTriangleApplication
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
+        // Per-instance model matrix, one column per attribute location
+        VkVertexInputBindingDescription instanceBinding = {};
+        instanceBinding.binding                         = INSTANCE_BINDING;
+        instanceBinding.stride                          = sizeof(Mat4);
+        instanceBinding.inputRate                       = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        std::vector<VkVertexInputAttributeDescription> attributes(4);
+        for (uint32_t i = 0; i < attributes.size(); ++i) {
+            attributes[i].location = 4 + i;
+            attributes[i].binding  = INSTANCE_BINDING;
+            attributes[i].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributes[i].offset   = i * 4 * sizeof(float);
+        }
+
+        std::vector<VkVertexInputBindingDescription> bindings = {instanceBinding};
+        if (meshVertices) {
+            VkVertexInputBindingDescription vertexBinding = {};
+            vertexBinding.binding                         = DrawList::MESH_VERTEX_BINDING;
+            vertexBinding.stride                          = sizeof(MeshFormat::Vertex);
+            vertexBinding.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+            bindings.push_back(vertexBinding);
+
+            attributes.push_back({0, DrawList::MESH_VERTEX_BINDING, VK_FORMAT_R32G32B32_SFLOAT,
+                                  offsetof(MeshFormat::Vertex, position)});
+            attributes.push_back({1, DrawList::MESH_VERTEX_BINDING, VK_FORMAT_R32G32B32_SFLOAT,
+                                  offsetof(MeshFormat::Vertex, normal)});
+            attributes.push_back({2, DrawList::MESH_VERTEX_BINDING, VK_FORMAT_R32G32_SFLOAT,
+                                  offsetof(MeshFormat::Vertex, uv)});
+        }
+
+        if (overlay) {
+            VkVertexInputBindingDescription quadBinding = {};
+            quadBinding.binding                         = HUD_BINDING;
+            quadBinding.stride                          = sizeof(HudQuad);
+            quadBinding.inputRate                       = VK_VERTEX_INPUT_RATE_INSTANCE;
+            bindings                                    = {quadBinding};
+
+            attributes = {
+                {0, HUD_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(HudQuad, rect)},
+                {1, HUD_BINDING, VK_FORMAT_R32G32_UINT, offsetof(HudQuad, glyph)},
+                {2, HUD_BINDING, VK_FORMAT_R8G8B8A8_UNORM, offsetof(HudQuad, color)},
+            };
+        }
+
         VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount   = 0;
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
+        vertexInputInfo.vertexBindingDescriptionCount   = bindings.size();
+        vertexInputInfo.pVertexBindingDescriptions      = bindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = attributes.size();
+        vertexInputInfo.pVertexAttributeDescriptions    = attributes.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
         inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.topology =
+            overlay ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport = {};
-        viewport.x          = 0.0f;
-        viewport.y          = 0.0f;
-        viewport.width      = m_swapChainExtent.width;
-        viewport.height     = m_swapChainExtent.height;
-        viewport.minDepth   = 0.0f;
-        viewport.maxDepth   = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset   = {0, 0};
-        scissor.extent   = m_swapChainExtent;
-
+        // Viewport and scissor are dynamic so pipelines survive swap chain
+        // recreation
         VkPipelineViewportStateCreateInfo viewportState = {};
         viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1;
-        viewportState.pViewports    = &viewport;
         viewportState.scissorCount  = 1;
-        viewportState.pScissors     = &scissor;
 
         VkPipelineRasterizationStateCreateInfo rasterizer = {};
         rasterizer.sType            = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -555,8 +855,10 @@ class HelloTriangleApplication
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
         rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth               = 1.0f;
-        rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+        rasterizer.cullMode                = overlay ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+        // Mesh files wind counter-clockwise, the camera's y flip keeps it so
+        rasterizer.frontFace =
+            meshVertices ? VK_FRONT_FACE_COUNTER_CLOCKWISE : VK_FRONT_FACE_CLOCKWISE;
         rasterizer.depthBiasEnable         = VK_FALSE;
 
         VkPipelineMultisampleStateCreateInfo multisampling = {};
@@ -564,11 +866,29 @@ class HelloTriangleApplication
         multisampling.sampleShadingEnable  = VK_FALSE;
         multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
+        // The shader-generated triangle has no meaningful depth
+        VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable  = meshVertices ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = meshVertices ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp   = VK_COMPARE_OP_LESS;
+
         VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                                               VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_FALSE;
 
+        // The overlay's background is translucent
+        if (overlay) {
+            colorBlendAttachment.blendEnable         = VK_TRUE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+            colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+        }
+
         VkPipelineColorBlendStateCreateInfo colorBlending = {};
         colorBlending.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlending.logicOpEnable     = VK_FALSE;
@@ -580,19 +900,12 @@ class HelloTriangleApplication
         colorBlending.blendConstants[2] = 0.0f; // Optional
         colorBlending.blendConstants[3] = 0.0f; // Optional
 
-        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
+        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
         VkPipelineDynamicStateCreateInfo dynamicState = {};
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        // dynamicState.dynamicStateCount = 2;
-        // dynamicState.pDynamicStates    = dynamicStates;
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) !=
-            VK_SUCCESS)
-            throw std::runtime_error{"failed to create pipeline layout!"};
+        dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates    = dynamicStates;
 
         VkGraphicsPipelineCreateInfo pipelineInfo = {};
         pipelineInfo.sType                        = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -603,7 +916,7 @@ class HelloTriangleApplication
         pipelineInfo.pViewportState               = &viewportState;
         pipelineInfo.pRasterizationState          = &rasterizer;
         pipelineInfo.pMultisampleState            = &multisampling;
-        pipelineInfo.pDepthStencilState           = nullptr; // Optional
+        pipelineInfo.pDepthStencilState           = &depthStencil;
         pipelineInfo.pColorBlendState             = &colorBlending;
         pipelineInfo.pDynamicState                = &dynamicState;
         pipelineInfo.layout                       = m_pipelineLayout;
@@ -612,16 +925,26 @@ class HelloTriangleApplication
         pipelineInfo.basePipelineHandle           = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex            = -1;
 
-        if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                      &m_graphicsPipeline) != VK_SUCCESS)
-            throw std::runtime_error{"failed to create graphics pipeline!"};
+        VkPipeline pipeline;
+        auto result =
+            vkCreateGraphicsPipelines(m_device, cache, 1, &pipelineInfo, nullptr, &pipeline);
 
         vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
         vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+
+        if (result != VK_SUCCESS) throw std::runtime_error{"failed to create graphics pipeline!"};
+        return pipeline;
     }
 
     VkShaderModule createShaderModule(const std::vector<std::byte>& code)
     {
+        // Hot reload may catch a file mid-write; don't hand that to the driver
+        constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+        uint32_t magic                 = 0;
+        if (code.size() >= sizeof(magic)) std::memcpy(&magic, code.data(), sizeof(magic));
+        if (code.size() % 4 != 0 || magic != SPIRV_MAGIC)
+            throw std::runtime_error{"invalid SPIR-V code!"};
+
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType                    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         createInfo.codeSize                 = code.size();
@@ -634,30 +957,253 @@ class HelloTriangleApplication
         return shaderModule;
     }
 
-    void createFramebuffers()
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProperties);
+
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
+            if ((typeFilter & (1 << i)) &&
+                (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+                return i;
+        }
+
+        throw std::runtime_error{"failed to find suitable memory type!"};
+    }
+
+    // All device memory goes through here so MemoryStats sees it
+    VkDeviceMemory allocateMemory(const VkMemoryRequirements& requirements,
+                                  VkMemoryPropertyFlags properties)
+    {
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize       = requirements.size;
+        allocInfo.memoryTypeIndex      = findMemoryType(requirements.memoryTypeBits, properties);
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+            throw std::runtime_error{"failed to allocate device memory!"};
+
+        m_memoryStats.onAllocate(memory, allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+        return memory;
+    }
+
+    void freeMemory(VkDeviceMemory memory)
+    {
+        m_memoryStats.onFree(memory);
+        vkFreeMemory(m_device, memory, nullptr);
+    }
+
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                      VkMemoryPropertyFlags properties, VkBuffer& buffer,
+                      VkDeviceMemory& bufferMemory)
+    {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size               = size;
+        bufferInfo.usage              = usage;
+        bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+            throw std::runtime_error{"failed to create buffer!"};
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
+
+        bufferMemory = allocateMemory(memRequirements, properties);
+        vkBindBufferMemory(m_device, buffer, bufferMemory, 0);
+    }
+
+    VkCommandBuffer beginSingleTimeCommands()
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool                 = m_commandPool;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error{"failed to allocate command buffers!"};
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    // Submits and waits for the queue to go idle
+    void endSingleTimeCommands(VkCommandBuffer commandBuffer)
+    {
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo       = {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &commandBuffer;
+
+        vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(m_graphicsQueue);
+
+        vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+    }
+
+    // The built-in triangle, plus the VT_MESH file which then replaces it in
+    // the scene. A replay uploads the captured meshes instead.
+    void createMeshes()
+    {
+        PROFILE_ZONE("createMeshes");
+
+        m_meshes        = {Mesh{VK_NULL_HANDLE, VK_NULL_HANDLE, {{0, 3, 0.0f, 0}}}};
+        m_meshBindings  = {MeshBinding{}}; // Triangle comes from the shader
+        m_sceneMesh     = TRIANGLE_MESH;
+        m_scenePipeline = MAIN_PIPELINE;
+
+        if (m_replay) return;
+
+        if (const char* filename = std::getenv("VT_MESH")) {
+            m_sceneMesh     = loadMesh(filename);
+            m_scenePipeline = MESH_PIPELINE;
+        }
+        ++m_sceneGeneration;
+    }
+
+    // The file is mapped, not parsed: its payload goes to device-local memory
+    // with one memcpy into staging and one vkCmdCopyBuffer. Vertices and
+    // indices share the buffer.
+    uint32_t loadMesh(const std::string& filename)
     {
-        m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
-        for (size_t i = 0; i < m_swapChainImageViews.size(); ++i) {
-            VkImageView attachments[] = {m_swapChainImageViews[i]};
+        PROFILE_ZONE("loadMesh");
 
-            VkFramebufferCreateInfo framebufferInfo = {};
-            framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass              = m_renderPass;
-            framebufferInfo.attachmentCount         = 1;
-            framebufferInfo.pAttachments            = attachments;
-            framebufferInfo.width                   = m_swapChainExtent.width;
-            framebufferInfo.height                  = m_swapChainExtent.height;
-            framebufferInfo.layers                  = 1;
+        uint64_t start = Profiler::now();
 
-            if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr,
-                                    &m_swapChainFramebuffers[i]))
-                throw std::runtime_error{"failed to create frambuffer!"};
+        MeshFile file(filename);
+        uint32_t mesh = uploadMesh(file.payload(), file.indexPayloadOffset(),
+                                   file.header().indexSize, file.lods());
+
+        std::cout << "Loaded " << filename << ": " << file.header().vertexCount << " vertices, "
+                  << file.header().indexCount / 3 << " triangles in " << file.lods().size()
+                  << " levels of detail in " << (Profiler::now() - start) / 1e6 << " ms\n";
+        return mesh;
+    }
+
+    // A mesh file payload, from a file or a capture
+    uint32_t uploadMesh(std::span<const std::byte> payload, uint64_t indexPayloadOffset,
+                        uint32_t indexSize, std::span<const MeshFormat::Lod> lods)
+    {
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingMemory;
+        createBuffer(payload.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     stagingBuffer, stagingMemory);
+
+        void* data;
+        vkMapMemory(m_device, stagingMemory, 0, payload.size(), 0, &data);
+        std::memcpy(data, payload.data(), payload.size());
+        vkUnmapMemory(m_device, stagingMemory);
+
+        Mesh mesh = {};
+        mesh.lods.assign(lods.begin(), lods.end());
+        createBuffer(payload.size(),
+                     VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.buffer, mesh.memory);
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkBufferCopy region           = {0, 0, payload.size()};
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, mesh.buffer, 1, &region);
+        endSingleTimeCommands(commandBuffer);
+
+        vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+        freeMemory(stagingMemory);
+
+        MeshBinding binding  = {};
+        binding.vertexBuffer = mesh.buffer;
+        binding.indexBuffer  = mesh.buffer;
+        binding.indexOffset  = indexPayloadOffset;
+        binding.indexType    = indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+        m_meshes.push_back(mesh);
+        m_meshBindings.push_back(binding);
+
+        m_capture.mesh(m_meshes.size() - 1, payload, indexPayloadOffset, indexSize, lods);
+        return m_meshes.size() - 1;
+    }
+
+    // A grid of VT_INSTANCES copies of the scene mesh under one root; a single
+    // centered one by default
+    void createScene()
+    {
+        PROFILE_ZONE("createScene");
+
+        const char* instancesEnv = std::getenv("VT_INSTANCES");
+        uint32_t instanceCount   = std::max(instancesEnv ? std::atoi(instancesEnv) : 1, 1);
+        uint32_t gridSize        = std::ceil(std::sqrt(float(instanceCount)));
+
+        auto root = m_transforms.createNode(TransformSystem::NO_PARENT, false);
+        m_transforms.setScale(root, 1.0f / gridSize);
+
+        std::vector<TransformSystem::NodeId> instances;
+        for (uint32_t i = 0; i < instanceCount; ++i) {
+            auto node = m_transforms.createNode(root, true);
+            m_transforms.setTranslation(node, 2.0f * (i % gridSize) + 1.0f - gridSize,
+                                        2.0f * (i / gridSize) + 1.0f - gridSize, 0.0f);
+            instances.push_back(node);
+        }
+        m_lodSelector.setInstances(std::move(instances));
+
+        if (const char* pixelError = std::getenv("VT_LOD_ERROR"))
+            m_lodPixelError = std::max(std::strtof(pixelError, nullptr), 0.0f);
+        ++m_sceneGeneration;
+    }
+
+    void createInstanceBuffers()
+    {
+        PROFILE_ZONE("createInstanceBuffers");
+
+        uint32_t instanceCount =
+            m_replay ? m_replay->maxInstanceCount() : m_transforms.instanceCount();
+        VkDeviceSize size = sizeof(Mat4) * std::max(instanceCount, 1u);
+
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            createBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         m_instanceBuffers[i], m_instanceBufferMemory[i]);
+
+            // Stays mapped; TransformSystem streams world matrices straight in
+            void* data;
+            vkMapMemory(m_device, m_instanceBufferMemory[i], 0, size, 0, &data);
+            m_instanceData[i]    = static_cast<Mat4*>(data);
+            m_instanceVersion[i] = 0;
+        }
+    }
+
+    // The overlay's quads and the indirect draw that reads them, so
+    // pre-recorded command buffers pick up each frame's count
+    void createHudBuffers()
+    {
+        PROFILE_ZONE("createHudBuffers");
+
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            createBuffer(sizeof(HudFrame),
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         m_hudBuffers[i], m_hudBufferMemory[i]);
+
+            void* data;
+            vkMapMemory(m_device, m_hudBufferMemory[i], 0, sizeof(HudFrame), 0, &data);
+            m_hudFrames[i]       = static_cast<HudFrame*>(data);
+            m_hudFrames[i]->draw = {4, 0, 0, 0};
         }
     }
 
     void createCommandPool()
     {
-        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_physicalDevice, m_surface);
+        PROFILE_ZONE("createCommandPool");
+
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_physicalDevice, surfaces());
 
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -666,22 +1212,100 @@ class HelloTriangleApplication
 
         if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
             throw std::runtime_error{"failed to create command pool!"};
+
+        // Pre-recorded buffers are never reset one by one, so the driver
+        // can allocate their memory as a whole
+        poolInfo.flags = 0;
+
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_staticCommandPool) != VK_SUCCESS)
+            throw std::runtime_error{"failed to create command pool!"};
     }
 
     void createCommandBuffers()
     {
+        PROFILE_ZONE("createCommandBuffers");
+
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool                 = m_commandPool;
         allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount          = m_commandBuffers.size();
+        allocInfo.commandBufferCount          = MAX_FRAMES_IN_FLIGHT;
+
+        for (auto& view : m_views) {
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, view.commandBuffers.data()) !=
+                VK_SUCCESS)
+                throw std::runtime_error{"failed to allocate command buffers!"};
+        }
+    }
 
-        if (vkAllocateCommandBuffers(m_device, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+    // One per swap chain image and frame in flight: the instance buffer and
+    // timestamp queries are per frame, everything else per image
+    void createStaticCommandBuffers(View& view)
+    {
+        PROFILE_ZONE("createStaticCommandBuffers");
+
+        view.staticCommandBuffers.resize(view.images.size() * MAX_FRAMES_IN_FLIGHT);
+        view.staticRecorded.assign(view.staticCommandBuffers.size(), false);
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool                 = m_staticCommandPool;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = view.staticCommandBuffers.size();
+
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, view.staticCommandBuffers.data()) !=
+            VK_SUCCESS)
             throw std::runtime_error{"failed to allocate command buffers!"};
     }
 
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    // Drops every view's pre-recorded command buffers once one of the inputs
+    // baked into them changes. Must be called before the frame's fence is
+    // reset.
+    void updateStaticInputs()
+    {
+        PROFILE_ZONE("updateStaticInputs");
+
+        StaticInputs inputs       = {};
+        inputs.pipelineGeneration = m_pipelineCompiler.generation();
+        inputs.sceneGeneration    = m_sceneGeneration;
+        inputs.timestamps         = timestampsEnabled();
+        inputs.hud                = m_hudEnabled;
+
+        if (inputs == m_staticInputs) return;
+
+        // Without RESET_COMMAND_BUFFER_BIT the buffers can only be reset
+        // with their pool, once none of them is pending
+        vkWaitForFences(m_device, m_inFlightFence.size(), m_inFlightFence.data(), VK_TRUE,
+                        UINT64_MAX);
+        vkResetCommandPool(m_device, m_staticCommandPool, 0);
+        for (auto& view : m_views)
+            view.staticRecorded.assign(view.staticRecorded.size(), false);
+        m_staticInputs = inputs;
+
+        buildDrawList();
+    }
+
+    // Recorded on first use and then resubmitted unchanged until
+    // updateStaticInputs() drops it
+    VkCommandBuffer staticCommandBuffer(View& view, uint32_t imageIndex)
+    {
+        PROFILE_ZONE("staticCommandBuffer");
+
+        uint32_t index = imageIndex * MAX_FRAMES_IN_FLIGHT + m_currentFrame;
+        if (!view.staticRecorded[index]) {
+            recordCommandBuffer(view.staticCommandBuffers[index], view, imageIndex);
+            view.staticRecorded[index] = true;
+            ++m_staticRecordings;
+        }
+
+        view.timestampsWritten[m_currentFrame] = m_staticInputs.timestamps;
+        return view.staticCommandBuffers[index];
+    }
+
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, View& view, uint32_t imageIndex)
     {
+        PROFILE_ZONE("recordCommandBuffer");
+
         VkCommandBufferBeginInfo beginInfo = {};
         beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags                    = 0;       // Optional
@@ -690,45 +1314,112 @@ class HelloTriangleApplication
         if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
             throw std::runtime_error{"failed to begin recording command buffer!"};
 
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass            = m_renderPass;
-        renderPassInfo.framebuffer           = m_swapChainFramebuffers[imageIndex];
-        renderPassInfo.renderArea.offset     = {0, 0};
-        renderPassInfo.renderArea.extent     = m_swapChainExtent;
-        VkClearValue clearColor              = {0.0f, 0.0f, 0.0f, 1.0f};
-        renderPassInfo.clearValueCount       = 1;
-        renderPassInfo.pClearValues          = &clearColor;
-
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        {
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        bool writeTimestamps = timestampsEnabled();
+        uint32_t query       = firstQuery(view, m_currentFrame);
+        if (writeTimestamps) {
+            vkCmdResetQueryPool(commandBuffer, m_queryPool, query, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool,
+                                query);
+        }
+
+        view.renderGraph.execute(commandBuffer, imageIndex);
+
+        if (writeTimestamps) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool,
+                                query + 1);
         }
-        vkCmdEndRenderPass(commandBuffer);
+        view.timestampsWritten[m_currentFrame] = writeTimestamps;
 
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error{"failed to record command buffer!"};
         }
     }
 
+    // Called by the view's render graph inside the scene pass
+    void recordScenePass(VkCommandBuffer commandBuffer, const View& view)
+    {
+        VkViewport viewport = {};
+        viewport.width      = view.extent.width;
+        viewport.height     = view.extent.height;
+        viewport.maxDepth   = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor = {{0, 0}, view.extent};
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, INSTANCE_BINDING, 1,
+                               &m_instanceBuffers[m_currentFrame], offsets);
+
+        Mat4 viewProj = cameraViewProj(view.extent);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                           sizeof(viewProj), &viewProj);
+
+        DrawBindings bindings   = {};
+        bindings.pipelineLayout = m_pipelineLayout;
+        bindings.pipelines      = m_pipelineCompiler.pipelines();
+        bindings.meshes         = m_meshBindings;
+        m_drawList.record(commandBuffer, bindings);
+
+        if (m_hudEnabled) recordHud(commandBuffer, view);
+    }
+
+    // Last in the pass, over the scene. Views share the frame's quads.
+    void recordHud(VkCommandBuffer commandBuffer, const View& view)
+    {
+        auto pipelines = m_pipelineCompiler.pipelines();
+        if (pipelines.size() <= HUD_PIPELINE || pipelines[HUD_PIPELINE] == VK_NULL_HANDLE) return;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[HUD_PIPELINE]);
+
+        VkDeviceSize offset = offsetof(HudFrame, quads);
+        vkCmdBindVertexBuffers(commandBuffer, HUD_BINDING, 1, &m_hudBuffers[m_currentFrame],
+                               &offset);
+
+        Mat4 pixelToClip = Mat4::pixelToClip(view.extent.width, view.extent.height);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                           sizeof(pixelToClip), &pixelToClip);
+
+        vkCmdDrawIndirect(commandBuffer, m_hudBuffers[m_currentFrame], offsetof(HudFrame, draw),
+                          1, sizeof(VkDrawIndirectCommand));
+    }
+
+    // Fixed camera framing the instance grid, which spans [-1, 1] in x and y
+    Mat4 cameraViewProj(VkExtent2D extent) const
+    {
+        float aspect = float(extent.width) / extent.height;
+        Mat4 proj    = Mat4::perspective(CAMERA_FOV_Y, aspect, 0.1f, 100.0f);
+        Mat4 view    = Mat4::fromTrs(0.0f, 0.0f, -CAMERA_DISTANCE, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+
+        Mat4 viewProj;
+        mat4Multiply(proj, view, viewProj);
+        return viewProj;
+    }
+
     void createSemaphores()
     {
+        PROFILE_ZONE("createSemaphores");
+
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr,
-                                  &m_imageAvailableSemaphore[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(m_device, &semaphoreInfo, nullptr,
-                                  &m_renderFinishedSemaphore[i]) != VK_SUCCESS) {
+                                  &m_renderFinishedSemaphore[i]) != VK_SUCCESS)
                 throw std::runtime_error{"failed to create semaphores!"};
+
+            for (auto& view : m_views) {
+                if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr,
+                                      &view.imageAvailableSemaphore[i]) != VK_SUCCESS)
+                    throw std::runtime_error{"failed to create semaphores!"};
             }
         }
     }
 
     void createFences()
     {
+        PROFILE_ZONE("createFences");
+
         VkFenceCreateInfo fenceInfo = {};
         fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags             = VK_FENCE_CREATE_SIGNALED_BIT;
@@ -739,68 +1430,400 @@ class HelloTriangleApplication
         }
     }
 
-    void recreateSwapChain()
+    void createQueryPool()
     {
-        int width  = 0;
-        int height = 0;
-        glfwGetFramebufferSize(m_window, &width, &height);
+        PROFILE_ZONE("createQueryPool");
+
+        QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice, surfaces());
+
+        uint32_t queueFamilyCount;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount,
+                                                 queueFamilies.data());
+
+        uint32_t validBits = queueFamilies[indices.graphicsFamily.value()].timestampValidBits;
+        if (validBits == 0) return; // No GPU zones in the trace
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        m_timestampPeriod = properties.limits.timestampPeriod;
+        m_timestampMask   = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+
+        VkQueryPoolCreateInfo queryPoolInfo = {};
+        queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount            = MAX_FRAMES_IN_FLIGHT * m_views.size() * 2;
+
+        if (vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+            throw std::runtime_error{"failed to create query pool!"};
+    }
+
+    // Finds the offset between GPU timestamps and Profiler::now() by writing a
+    // timestamp from an otherwise empty submit. The error is bounded by half
+    // the submit round trip; must be called with the queue idle.
+    void calibrateGpuClock()
+    {
+        PROFILE_ZONE("calibrateGpuClock");
+
+        if (m_queryPool == VK_NULL_HANDLE) return;
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool                 = m_commandPool;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount          = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error{"failed to allocate command buffers!"};
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        vkCmdResetQueryPool(commandBuffer, m_queryPool, 0, 1);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 0);
+        vkEndCommandBuffer(commandBuffer);
 
-        while (width == 0 || height == 0) {
-            glfwGetFramebufferSize(m_window, &width, &height);
-            glfwWaitEvents();
+        VkSubmitInfo submitInfo       = {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &commandBuffer;
+
+        uint64_t cpuBefore = Profiler::now();
+        vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(m_graphicsQueue);
+        uint64_t cpuAfter = Profiler::now();
+
+        uint64_t ticks = 0;
+        vkGetQueryPoolResults(m_device, m_queryPool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+        m_gpuClockOffset = static_cast<int64_t>(cpuBefore + (cpuAfter - cpuBefore) / 2) -
+                           static_cast<int64_t>(gpuTicksToNanoseconds(ticks));
+
+        vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+        for (auto& view : m_views)
+            view.timestampsWritten.fill(false);
+    }
+
+    uint64_t gpuTicksToNanoseconds(uint64_t ticks) const
+    {
+        return static_cast<uint64_t>((ticks & m_timestampMask) * double{m_timestampPeriod});
+    }
+
+    // Frame times and the HUD's GPU graph need GPU timestamps too, not just
+    // the profiler
+    bool timestampsEnabled() const
+    {
+        return m_queryPool != VK_NULL_HANDLE &&
+               (Profiler::isEnabled() || m_printStats || m_replay || m_hudEnabled);
+    }
+
+    // Begin and end timestamps of the view's command buffer
+    uint32_t firstQuery(const View& view, uint32_t frame) const
+    {
+        return (frame * m_views.size() + view.id) * 2;
+    }
+
+    // Called once the frame's fence has signaled, so results are available.
+    // The frame spans from the first view's command buffer starting to the
+    // last one finishing.
+    void collectGpuTimestamps(uint32_t frame)
+    {
+        uint64_t begin = UINT64_MAX;
+        uint64_t end   = 0;
+        for (auto& view : m_views) {
+            if (!view.timestampsWritten[frame]) continue;
+            view.timestampsWritten[frame] = false;
+
+            std::array<uint64_t, 2> ticks = {};
+            if (vkGetQueryPoolResults(m_device, m_queryPool, firstQuery(view, frame), 2,
+                                      sizeof(ticks), ticks.data(), sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+                continue;
+
+            begin = std::min(begin, gpuTicksToNanoseconds(ticks[0]) + m_gpuClockOffset);
+            end   = std::max(end, gpuTicksToNanoseconds(ticks[1]) + m_gpuClockOffset);
+        }
+        if (begin > end) return;
+
+        Profiler::recordGpu("frame", begin, end);
+        m_frameTimes.addGpu(end - begin);
+        m_hud.addGpu(end - begin);
+    }
+
+    void recreateSwapChain(View& view)
+    {
+        PROFILE_ZONE("recreateSwapChain");
+
+        if (view.window) {
+            int width  = 0;
+            int height = 0;
+            glfwGetFramebufferSize(view.window, &width, &height);
+
+            while (width == 0 || height == 0) {
+                glfwGetFramebufferSize(view.window, &width, &height);
+                glfwWaitEvents();
+            }
         }
 
         vkDeviceWaitIdle(m_device);
+        view.framebufferResized = false;
+        ++m_swapChainRecreations;
 
-        cleanupSwapChain();
+        cleanupSwapChain(view);
 
-        createSwapChain();
-        createImageViews();
-        createFramebuffers();
+        createSwapChain(view);
+        createImageViews(view);
+        allocateRenderGraph(view);
+
+        // The image count may have changed
+        vkFreeCommandBuffers(m_device, m_staticCommandPool, view.staticCommandBuffers.size(),
+                             view.staticCommandBuffers.data());
+        createStaticCommandBuffers(view);
+
+        calibrateGpuClock();
+    }
+
+    bool windowClosed() const
+    {
+        return std::any_of(m_views.cbegin(), m_views.cend(), [](const View& view) {
+            return view.window && glfwWindowShouldClose(view.window);
+        });
     }
 
     void mainLoop()
     {
-        while (!glfwWindowShouldClose(m_window)) {
-            glfwPollEvents();
-            drawFrame();
+        if (m_replay) {
+            replayLoop();
+            return;
+        }
+
+        uint64_t nextStatsTime = 0;
+
+        // Headless runs have no window to close
+        const char* framesEnv = std::getenv("VT_FRAMES");
+        uint64_t frameLimit   = framesEnv ? std::strtoull(framesEnv, nullptr, 10) : UINT64_MAX;
+
+        while (!windowClosed() && m_frameCount < frameLimit) {
+            if (!m_headless) glfwPollEvents();
+            timedDrawFrame();
+
+            if (Profiler::now() >= nextStatsTime) {
+                nextStatsTime = Profiler::now() + STATS_INTERVAL_NS;
+                m_memoryStats.update();
+                if (m_printStats) {
+                    m_memoryStats.print(std::cout);
+                    m_drawList.stats().print(std::cout);
+                    m_lodSelector.stats().print(std::cout);
+                    printCommandStats();
+                    m_frameTimes.print(std::cout);
+                    m_frameTimes.clear();
+                    if (m_hudEnabled) m_hud.stats().print(std::cout);
+                }
+            }
+
+            if (m_dumpTraceRequested) {
+                m_dumpTraceRequested = false;
+                if (Profiler::dump("trace.json"))
+                    std::cout << "Trace written to trace.json\n";
+                else
+                    std::cerr << "failed to write trace.json\n";
+            }
         }
 
         vkDeviceWaitIdle(m_device);
     }
 
+    void timedDrawFrame()
+    {
+        uint64_t start = Profiler::now();
+        drawFrame();
+
+        uint64_t cpuNs = Profiler::now() - start;
+        m_frameTimes.addCpu(cpuNs);
+        m_hud.addCpu(cpuNs);
+    }
+
+    // Every frame of the capture as fast as the views present, then one
+    // report covering the whole run
+    void replayLoop()
+    {
+        uint64_t start = Profiler::now();
+        while (replayFrame())
+            timedDrawFrame();
+
+        vkDeviceWaitIdle(m_device);
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame)
+            collectGpuTimestamps(frame);
+
+        std::cout << "Replayed " << m_frameCount << " frames in " << (Profiler::now() - start) / 1e6
+                  << " ms\n";
+        m_frameTimes.print(std::cout);
+        m_drawList.stats().print(std::cout);
+        printCommandStats();
+        m_memoryStats.update();
+        m_memoryStats.print(std::cout);
+    }
+
+    // Applies the capture's records up to the end of the next frame; false
+    // once it is exhausted. Meshes and pipelines get the ids they had when
+    // captured, as long as they are created in the same order.
+    bool replayFrame()
+    {
+        PROFILE_ZONE("replayFrame");
+
+        using namespace CaptureFormat;
+
+        CaptureReader::Record record;
+        while (m_replay->next(record)) {
+            switch (record.type) {
+            case MESH: {
+                auto mesh   = record.get<MeshRecord>();
+                uint32_t id = uploadMesh(record.tail<MeshRecord>(), mesh.indexPayloadOffset,
+                                         mesh.indexSize, {mesh.lods, mesh.lodCount});
+                if (id != mesh.mesh) throw std::runtime_error{"capture mesh ids do not match!"};
+                ++m_sceneGeneration;
+                break;
+            }
+            case PIPELINE: {
+                auto pipeline = record.get<PipelineRecord>();
+                auto paths    = record.tail<PipelineRecord>();
+                auto text     = reinterpret_cast<const char*>(paths.data());
+
+                PipelineDesc desc   = {};
+                desc.vertexShader   = {text, pipeline.vertexShaderLength};
+                desc.fragmentShader = {text + pipeline.vertexShaderLength,
+                                       pipeline.fragmentShaderLength};
+                desc.meshVertices   = pipeline.meshVertices;
+                desc.overlay        = pipeline.overlay;
+
+                // Compiled before the frame, so no frame depends on compile time
+                if (m_pipelineCompiler.compileNow(desc) != pipeline.pipeline)
+                    throw std::runtime_error{"capture pipeline ids do not match!"};
+                m_capture.pipeline(pipeline.pipeline, desc);
+                break;
+            }
+            case RESIZE: {
+                auto resize = record.get<ResizeRecord>();
+                View& view  = m_views[resize.view];
+
+                VkExtent2D extent = {resize.width, resize.height};
+                if (extent.width == view.extent.width && extent.height == view.extent.height)
+                    break;
+                view.headlessExtent = extent;
+                recreateSwapChain(view);
+                break;
+            }
+            case INSTANCES:
+                m_replayInstances.resize(record.payload.size() / sizeof(Mat4));
+                std::memcpy(m_replayInstances.data(), record.payload.data(),
+                            record.payload.size());
+                ++m_replayInstanceVersion;
+                break;
+            case DRAWS:
+                m_replayDraws.resize(record.payload.size() / sizeof(Draw));
+                std::memcpy(m_replayDraws.data(), record.payload.data(), record.payload.size());
+                ++m_sceneGeneration;
+                break;
+            case FRAME:
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Every view that acquired an image goes into one submit and one present.
+    // A view whose swap chain is out of date is recreated and sits the frame
+    // out.
     void drawFrame()
     {
-        vkWaitForFences(m_device, 1, &m_inFlightFence[m_currentFrame], VK_TRUE, UINT64_MAX);
+        PROFILE_ZONE("drawFrame");
 
-        uint32_t imageIndex;
-        auto result = vkAcquireNextImageKHR(m_device, m_swapChain, UINT64_MAX,
-                                            m_imageAvailableSemaphore[m_currentFrame],
-                                            VK_NULL_HANDLE, &imageIndex);
+        vkWaitForFences(m_device, 1, &m_inFlightFence[m_currentFrame], VK_TRUE, UINT64_MAX);
+        collectGpuTimestamps(m_currentFrame);
+        m_pipelineCompiler.update(m_frameCount++);
+
+        m_frameViews.clear();
+        for (auto& view : m_views) {
+            uint32_t imageIndex;
+            auto result = vkAcquireNextImageKHR(m_device, view.swapChain, UINT64_MAX,
+                                                view.imageAvailableSemaphore[m_currentFrame],
+                                                VK_NULL_HANDLE, &imageIndex);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                recreateSwapChain(view);
+                continue;
+            } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error{"failed to acquire swap chain image!"};
+            }
+            m_frameViews.add(view, imageIndex, view.imageAvailableSemaphore[m_currentFrame]);
+        }
+        if (m_frameViews.views.empty()) return;
+
+        // The fence guarantees the GPU is done reading this frame's instances.
+        // Updating them first lets LOD selection see this frame's matrices.
+        uint64_t& instanceVersion = m_instanceVersion[m_currentFrame];
+        Mat4* instances           = m_instanceData[m_currentFrame];
+        if (!m_replay) {
+            instanceVersion = m_transforms.update(m_threadPool, instances, instanceVersion);
+            m_capture.instances(instanceVersion, {instances, m_transforms.instanceCount()});
+        } else {
+            if (instanceVersion != m_replayInstanceVersion) {
+                std::copy(m_replayInstances.begin(), m_replayInstances.end(), instances);
+                instanceVersion = m_replayInstanceVersion;
+            }
+            m_capture.instances(m_replayInstanceVersion, m_replayInstances); // Re-capturing
+        }
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            recreateSwapChain();
-            return;
-        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw std::runtime_error{"failed to acquire swap chain image!"};
+        if (!m_replay) selectLods();
+
+        uint64_t commandStart = Profiler::now();
+        if (m_staticCommands)
+            updateStaticInputs();
+        else
+            buildDrawList();
+
+        // Every view records the same draw list; its stats cover one
+        // recording, so the draw counters below count the list once per frame
+        for (size_t i = 0; i < m_frameViews.views.size(); ++i) {
+            View& view          = *m_frameViews.views[i];
+            uint32_t imageIndex = m_frameViews.imageIndices[i];
+
+            VkCommandBuffer commandBuffer;
+            if (m_staticCommands) {
+                commandBuffer = staticCommandBuffer(view, imageIndex);
+            } else {
+                commandBuffer = view.commandBuffers[m_currentFrame];
+                vkResetCommandBuffer(commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+                recordCommandBuffer(commandBuffer, view, imageIndex);
+            }
+            m_frameViews.commandBuffers.push_back(commandBuffer);
         }
+        uint64_t commandNs = Profiler::now() - commandStart;
+        m_commandTimes[m_staticCommands].totalNs += commandNs;
+        m_commandTimes[m_staticCommands].frames += 1;
+
+        Profiler::recordCounter("command buffer CPU (us)", commandNs / 1000.0);
+        Profiler::recordCounter("draw list sort (us)", m_drawList.stats().sortNs / 1000.0);
+        Profiler::recordCounter("binds elided", m_drawList.stats().bindsElided());
+        Profiler::recordCounter("triangles", m_lodSelector.stats().trianglesSubmitted);
 
         vkResetFences(m_device, 1, &m_inFlightFence[m_currentFrame]);
-        vkResetCommandBuffer(m_commandBuffers[m_currentFrame],
-                             /*VkCommandBufferResetFlagBits*/ 0);
-        recordCommandBuffer(m_commandBuffers[m_currentFrame], imageIndex);
+
+        if (m_hudEnabled) buildHud();
 
         VkSubmitInfo submitInfo = {};
         submitInfo.sType        = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[]      = {m_imageAvailableSemaphore[m_currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores    = waitSemaphores;
-        submitInfo.pWaitDstStageMask  = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers    = &m_commandBuffers[m_currentFrame];
+        submitInfo.waitSemaphoreCount = m_frameViews.waitSemaphores.size();
+        submitInfo.pWaitSemaphores    = m_frameViews.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask  = m_frameViews.waitStages.data();
+        submitInfo.commandBufferCount = m_frameViews.commandBuffers.size();
+        submitInfo.pCommandBuffers    = m_frameViews.commandBuffers.data();
 
         VkSemaphore signalSemaphores[]  = {m_renderFinishedSemaphore[m_currentFrame]};
         submitInfo.signalSemaphoreCount = 1;
@@ -817,97 +1840,395 @@ class HelloTriangleApplication
         presentInfo.waitSemaphoreCount = 1;
         presentInfo.pWaitSemaphores    = signalSemaphores;
 
-        VkSwapchainKHR swapChains[] = {m_swapChain};
-        presentInfo.swapchainCount  = 1;
-        presentInfo.pSwapchains     = swapChains;
-        presentInfo.pImageIndices   = &imageIndex;
-        presentInfo.pResults        = nullptr; // Optional
+        presentInfo.swapchainCount = m_frameViews.swapChains.size();
+        presentInfo.pSwapchains    = m_frameViews.swapChains.data();
+        presentInfo.pImageIndices  = m_frameViews.imageIndices.data();
+        presentInfo.pResults       = m_frameViews.results.data();
 
-        result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+        // The per-swap chain results tell which views need recreating
+        vkQueuePresentKHR(m_presentQueue, &presentInfo);
+        m_capture.endFrame(m_frameCount);
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-            m_framebufferResized) {
-            recreateSwapChain();
-            return;
-        } else if (result != VK_SUCCESS) {
-            throw std::runtime_error{"failed to present swap chain image!"};
+        for (size_t i = 0; i < m_frameViews.views.size(); ++i) {
+            View& view      = *m_frameViews.views[i];
+            VkResult result = m_frameViews.results[i];
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+                view.framebufferResized) {
+                recreateSwapChain(view);
+            } else if (result != VK_SUCCESS) {
+                throw std::runtime_error{"failed to present swap chain image!"};
+            }
         }
 
         m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
-    void cleanupSwapChain()
+    // Into this frame's HUD buffer, which the fence says the GPU is done with
+    void buildHud()
+    {
+        HudCounters counters          = {};
+        counters.draws                = m_drawList.stats().draws;
+        counters.instances            = m_replay ? m_replayInstances.size()
+                                                 : m_transforms.instanceCount();
+        counters.triangles            = m_lodSelector.stats().trianglesSubmitted;
+        counters.swapChainRecreations = m_swapChainRecreations;
+        for (const auto& heap : m_memoryStats.heaps()) {
+            if (!heap.deviceLocal) continue;
+            counters.memoryUsage += heap.usage;
+            counters.memoryBudget += heap.budget;
+        }
+
+        HudFrame* frame           = m_hudFrames[m_currentFrame];
+        frame->draw.instanceCount = m_hud.build(counters, frame->quads);
+        Profiler::recordCounter("HUD CPU (us)", m_hud.stats().buildNs / 1000.0);
+    }
+
+    // CPU time to get the frame's command buffer, per path, since startup
+    void printCommandStats() const
+    {
+        const auto& rerecorded  = m_commandTimes[false];
+        const auto& prerecorded = m_commandTimes[true];
+
+        std::cout << "Command buffers: " << (m_staticCommands ? "pre-recorded" : "re-recorded");
+        if (rerecorded.frames > 0)
+            std::cout << ", re-recording " << rerecorded.averageUs() << " us/frame";
+        if (prerecorded.frames > 0) {
+            std::cout << ", pre-recorded " << prerecorded.averageUs() << " us/frame ("
+                      << m_staticRecordings << " recordings)";
+        }
+        if (rerecorded.frames > 0 && prerecorded.frames > 0)
+            std::cout << ", saving " << rerecorded.averageUs() - prerecorded.averageUs()
+                      << " us/frame";
+        std::cout << '\n';
+    }
+
+    void buildDrawList()
     {
-        for (auto& fb : m_swapChainFramebuffers)
-            vkDestroyFramebuffer(m_device, fb, nullptr);
+        PROFILE_ZONE("buildDrawList");
+
+        m_drawList.clear();
+        m_capture.beginDraws();
+
+        if (m_replay) {
+            for (const auto& draw : m_replayDraws)
+                addDraw(draw.command, draw.depth);
+            m_drawList.sort(m_threadPool);
+            return;
+        }
 
-        for (auto& iv : m_swapChainImageViews)
+        // One instanced draw per run of instances on the same level
+        const auto& lods = m_meshes[m_sceneMesh].lods;
+        for (const auto& run : m_lodSelector.runs()) {
+            DrawCommand draw   = {};
+            draw.pipeline      = m_scenePipeline;
+            draw.mesh          = m_sceneMesh;
+            draw.count         = lods[run.lod].indexCount;
+            draw.firstIndex    = lods[run.lod].firstIndex;
+            draw.instanceCount = run.instanceCount;
+            draw.firstInstance = run.firstInstance;
+            addDraw(draw, 0.0f);
+        }
+
+        m_drawList.sort(m_threadPool);
+    }
+
+    void addDraw(const DrawCommand& draw, float depth)
+    {
+        m_drawList.add(draw, depth);
+        m_capture.draw(draw, depth);
+    }
+
+    // A change of level invalidates the pre-recorded command buffers. Views
+    // share the draw list, so the tallest one sets the detail.
+    void selectLods()
+    {
+        float height = 0.0f;
+        for (const auto& view : m_views)
+            height = std::max(height, float(view.extent.height));
+
+        LodView view       = {};
+        view.eye[2]        = CAMERA_DISTANCE;
+        view.pixelsPerUnit = height / (2.0f * std::tan(CAMERA_FOV_Y / 2.0f));
+        view.maxPixelError = m_lodPixelError;
+
+        if (m_lodSelector.select(m_threadPool, m_transforms, m_meshes[m_sceneMesh].lods, view))
+            ++m_sceneGeneration;
+    }
+
+    void cleanupSwapChain(View& view)
+    {
+        for (auto& iv : view.imageViews)
             vkDestroyImageView(m_device, iv, nullptr);
 
-        vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+        vkDestroySwapchainKHR(m_device, view.swapChain, nullptr);
     }
 
     void cleanup()
     {
+        m_capture.close();
+
+        if (m_queryPool != VK_NULL_HANDLE) vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             vkDestroyFence(m_device, m_inFlightFence[i], nullptr);
         }
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             vkDestroySemaphore(m_device, m_renderFinishedSemaphore[i], nullptr);
-            vkDestroySemaphore(m_device, m_imageAvailableSemaphore[i], nullptr);
+            for (auto& view : m_views)
+                vkDestroySemaphore(m_device, view.imageAvailableSemaphore[i], nullptr);
         }
+        vkDestroyCommandPool(m_device, m_staticCommandPool, nullptr);
         vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 
-        cleanupSwapChain();
+        for (auto& mesh : m_meshes) {
+            if (mesh.buffer == VK_NULL_HANDLE) continue;
+            vkDestroyBuffer(m_device, mesh.buffer, nullptr);
+            freeMemory(mesh.memory);
+        }
+
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            vkUnmapMemory(m_device, m_instanceBufferMemory[i]);
+            vkDestroyBuffer(m_device, m_instanceBuffers[i], nullptr);
+            freeMemory(m_instanceBufferMemory[i]);
+
+            vkUnmapMemory(m_device, m_hudBufferMemory[i]);
+            vkDestroyBuffer(m_device, m_hudBuffers[i], nullptr);
+            freeMemory(m_hudBufferMemory[i]);
+        }
+
+        // Background compiles use m_renderPass, which view 0's render graph
+        // owns, so they must finish first
+        m_pipelineCompiler.destroy();
+
+        for (auto& view : m_views) {
+            view.renderGraph.destroy();
+            cleanupSwapChain(view);
+        }
 
-        vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
-        vkDestroyRenderPass(m_device, m_renderPass, nullptr);
 
         vkDestroyDevice(m_device, nullptr);
-        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        for (auto& view : m_views)
+            vkDestroySurfaceKHR(m_instance, view.surface, nullptr);
         vkDestroyInstance(m_instance, nullptr);
 
-        glfwDestroyWindow(m_window);
+        if (m_headless) return;
+
+        for (auto& view : m_views)
+            glfwDestroyWindow(view.window);
         glfwTerminate();
     }
 
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr int MAX_FRAMES_IN_FLIGHT    = 2;
+    static constexpr uint64_t STATS_INTERVAL_NS = 1'000'000'000;
+
+    // Window size, and swap chain size of headless views
+    static constexpr uint32_t WINDOW_WIDTH  = 800;
+    static constexpr uint32_t WINDOW_HEIGHT = 600;
+
+    // Mesh vertices use DrawList::MESH_VERTEX_BINDING
+    static constexpr uint32_t INSTANCE_BINDING = 1;
+    static constexpr uint32_t HUD_BINDING      = 0; // Only bound by the overlay pipeline
+
+    // PipelineCompiler ids, in creation order
+    static constexpr uint32_t MAIN_PIPELINE          = 0;
+    static constexpr uint32_t MESH_FALLBACK_PIPELINE = 1;
+    static constexpr uint32_t MESH_PIPELINE          = 2;
+    static constexpr uint32_t HUD_PIPELINE           = 3;
+
+    static constexpr uint32_t TRIANGLE_MESH = 0;
+
+    static constexpr float CAMERA_FOV_Y    = 0.785398f; // 45 degrees
+    static constexpr float CAMERA_DISTANCE = 2.5f;
+
+    // A window, or a headless surface, with its swap chain. Views share the
+    // device, pipelines and scene; each has its own render graph.
+    struct View
+    {
+        uint32_t id             = 0;       // Index in m_views
+        GLFWwindow* window      = nullptr; // Null when headless
+        VkSurfaceKHR surface    = VK_NULL_HANDLE;
+        bool framebufferResized = false;
+
+        VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+        std::vector<VkImage> images;
+        VkFormat imageFormat = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent    = {};
+        std::vector<VkImageView> imageViews;
+        VkExtent2D headlessExtent = {WINDOW_WIDTH, WINDOW_HEIGHT}; // Set by replays
+
+        RenderGraph renderGraph;
+        RenderGraph::ResourceId backbuffer = 0;
+
+        std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> imageAvailableSemaphore;
+        std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT>
+            commandBuffers; // Destroyed with commandPool
+        std::vector<VkCommandBuffer> staticCommandBuffers; // Destroyed with staticCommandPool
+        std::vector<bool> staticRecorded;
+        std::array<bool, MAX_FRAMES_IN_FLIGHT> timestampsWritten = {};
+    };
+
+    // The views that acquired an image this frame, laid out for
+    // vkQueueSubmit and vkQueuePresentKHR; kept to reuse the allocations
+    struct FrameViews
+    {
+        std::vector<View*> views;
+        std::vector<VkSwapchainKHR> swapChains;
+        std::vector<uint32_t> imageIndices;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkResult> results;
+
+        void clear()
+        {
+            views.clear();
+            swapChains.clear();
+            imageIndices.clear();
+            waitSemaphores.clear();
+            waitStages.clear();
+            commandBuffers.clear();
+            results.clear();
+        }
+
+        // The acquire semaphore is waited for at color attachment output
+        void add(View& view, uint32_t imageIndex, VkSemaphore imageAvailable)
+        {
+            views.push_back(&view);
+            swapChains.push_back(view.swapChain);
+            imageIndices.push_back(imageIndex);
+            waitSemaphores.push_back(imageAvailable);
+            waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            results.push_back(VK_SUCCESS);
+        }
+    };
 
-    GLFWwindow* m_window = nullptr;
     VkInstance m_instance;
-    VkSurfaceKHR m_surface;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE; // Destroyed with instance
     VkDevice m_device;
+    MemoryStats m_memoryStats;
 
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
 
-    VkSwapchainKHR m_swapChain;
-    std::vector<VkImage> m_swapChainImages;
-    VkFormat m_swapChainImageFormat;
-    VkExtent2D m_swapChainExtent;
-    std::vector<VkImageView> m_swapChainImageViews;
-    VkRenderPass m_renderPass;
+    std::vector<View> m_views; // VT_VIEWS of them, never resized after initWindow()
+    FrameViews m_frameViews;
+    VkRenderPass m_renderPass; // The first view's scene pass, owned by its render graph
 
     VkPipelineLayout m_pipelineLayout;
-    VkPipeline m_graphicsPipeline;
+    PipelineCompiler m_pipelineCompiler;
 
-    std::vector<VkFramebuffer> m_swapChainFramebuffers;
     VkCommandPool m_commandPool;
-    std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT>
-        m_commandBuffers; // Destroyed with commandPool
 
-    std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> m_imageAvailableSemaphore;
-    std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> m_renderFinishedSemaphore;
+    // Everything baked into pre-recorded command buffers besides the swap
+    // chain, which reallocates them
+    struct StaticInputs
+    {
+        uint64_t pipelineGeneration = UINT64_MAX;
+        uint64_t sceneGeneration    = 0;
+        bool timestamps             = false;
+        bool hud                    = false;
+
+        bool operator==(const StaticInputs&) const = default;
+    };
+
+    struct CommandTime
+    {
+        uint64_t totalNs = 0;
+        uint64_t frames  = 0;
+
+        double averageUs() const { return totalNs / 1000.0 / frames; }
+    };
+
+    VkCommandPool m_staticCommandPool;
+    StaticInputs m_staticInputs;
+    uint64_t m_staticRecordings = 0;
+    std::array<CommandTime, 2> m_commandTimes; // Indexed by m_staticCommands
+
+    std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> m_renderFinishedSemaphore; // Shared by views
     std::array<VkFence, MAX_FRAMES_IN_FLIGHT> m_inFlightFence;
 
     uint32_t m_currentFrame = 0;
+    uint64_t m_frameCount   = 0;
+
+    ThreadPool m_threadPool;
+    TransformSystem m_transforms;
+    DrawList m_drawList;
+
+    struct Mesh
+    {
+        VkBuffer buffer       = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        std::vector<MeshFormat::Lod> lods; // Vertex counts for shader-generated meshes
+    };
+    std::vector<Mesh> m_meshes;
+    std::vector<MeshBinding> m_meshBindings; // Parallel to m_meshes
+    uint32_t m_sceneMesh       = TRIANGLE_MESH;
+    uint32_t m_scenePipeline   = MAIN_PIPELINE;
+    uint64_t m_sceneGeneration = 0; // Bumped when meshes or draws change
+
+    LodSelector m_lodSelector;
+    float m_lodPixelError = 1.0f; // VT_LOD_ERROR
+
+    std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> m_instanceBuffers;
+    std::array<VkDeviceMemory, MAX_FRAMES_IN_FLIGHT> m_instanceBufferMemory;
+    std::array<Mat4*, MAX_FRAMES_IN_FLIGHT> m_instanceData;
+    std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_instanceVersion;
+
+    struct HudFrame
+    {
+        VkDrawIndirectCommand draw; // instanceCount is the quad count
+        HudQuad quads[Hud::MAX_QUADS];
+    };
+    Hud m_hud;
+    std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> m_hudBuffers;
+    std::array<VkDeviceMemory, MAX_FRAMES_IN_FLIGHT> m_hudBufferMemory;
+    std::array<HudFrame*, MAX_FRAMES_IN_FLIGHT> m_hudFrames;
+    uint64_t m_swapChainRecreations = 0;
+
+    VkQueryPool m_queryPool  = VK_NULL_HANDLE; // Two queries per frame and view
+    float m_timestampPeriod  = 1.0f;
+    uint64_t m_timestampMask = UINT64_MAX;
+    int64_t m_gpuClockOffset = 0;
+
+    bool m_headless   = false; // VT_HEADLESS, VK_EXT_headless_surface instead of windows
+    bool m_printStats = false; // VT_STATS
+
+    FrameTimes m_frameTimes; // Since the last stats print
+
+    CaptureWriter m_capture; // VT_CAPTURE
+    std::unique_ptr<CaptureReader> m_replay;
+    std::vector<Mat4> m_replayInstances;
+    uint64_t m_replayInstanceVersion = 0;
+    std::vector<CaptureFormat::Draw> m_replayDraws;
 
   public:
-    bool m_framebufferResized = false;
+    bool m_dumpTraceRequested = false;
+    bool m_staticCommands     = false; // Toggled with F10
+    bool m_hudEnabled         = false; // VT_HUD, toggled with F9
 };
 
+#ifdef VT_REPLAY
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <capture>\n";
+        return EXIT_FAILURE;
+    }
+
+    HelloTriangleApplication app;
+
+    try {
+        app.replay(argv[1]);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+#else
 int main()
 {
     HelloTriangleApplication app;
@@ -921,11 +2242,30 @@ int main()
 
     return EXIT_SUCCESS;
 }
+#endif
 
 //------------------------------------------------------------------------------
 
 static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 {
     auto app = static_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
-    app->m_framebufferResized = true;
+    app->onFramebufferResized(window);
+}
+
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS) return;
+
+    if (key == GLFW_KEY_F9) {
+        auto app = static_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+        app->m_hudEnabled = !app->m_hudEnabled;
+    } else if (key == GLFW_KEY_F10) {
+        auto app = static_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+        app->m_staticCommands = !app->m_staticCommands;
+    } else if (key == GLFW_KEY_F11) {
+        Profiler::setEnabled(!Profiler::isEnabled());
+    } else if (key == GLFW_KEY_F12) {
+        auto app = static_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+        app->m_dumpTraceRequested = true;
+    }
 }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+
+// Column-major like GLSL: m[column * 4 + row]
+struct alignas(16) Mat4
+{
+    float m[16];
+
+    static Mat4 identity()
+    {
+        return {{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f}};
+    }
+
+    // Rotation from a unit quaternion, uniform scale, then translation
+    static Mat4 fromTrs(float tx, float ty, float tz, float qx, float qy, float qz, float qw,
+                        float s)
+    {
+        float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+        float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+        float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+        return {{s * (1.0f - 2.0f * (yy + zz)), s * 2.0f * (xy + wz), s * 2.0f * (xz - wy), 0.0f,
+                 s * 2.0f * (xy - wz), s * (1.0f - 2.0f * (xx + zz)), s * 2.0f * (yz + wx), 0.0f,
+                 s * 2.0f * (xz + wy), s * 2.0f * (yz - wx), s * (1.0f - 2.0f * (xx + yy)), 0.0f,
+                 tx, ty, tz, 1.0f}};
+    }
+
+    // Right-handed view space looking down -z, Vulkan clip space: y down,
+    // depth in [0, 1]
+    static Mat4 perspective(float fovY, float aspect, float zNear, float zFar)
+    {
+        float f = 1.0f / std::tan(fovY * 0.5f);
+        float a = zFar / (zNear - zFar);
+
+        return {{f / aspect, 0.0f, 0.0f, 0.0f, 0.0f, -f, 0.0f, 0.0f, 0.0f, 0.0f, a, -1.0f, 0.0f,
+                 0.0f, a * zNear, 0.0f}};
+    }
+
+    // Pixels from the top left of a width x height viewport to Vulkan clip
+    // space, which also has y down
+    static Mat4 pixelToClip(float width, float height)
+    {
+        return {{2.0f / width, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f / height, 0.0f, 0.0f, 0.0f, 0.0f,
+                 1.0f, 0.0f, -1.0f, -1.0f, 0.0f, 1.0f}};
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// out = a * b, out may not alias a or b
+inline void mat4Multiply(const Mat4& a, const Mat4& b, Mat4& out)
+{
+#if defined(__AVX__)
+    // Two output columns per iteration: a's columns are duplicated into both
+    // lanes, b's elements are broadcast within their own lane
+    __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[0]));
+    __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[4]));
+    __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[8]));
+    __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[12]));
+
+    for (int j = 0; j < 16; j += 8) {
+        __m256 bj = _mm256_loadu_ps(&b.m[j]);
+        __m256 r  = _mm256_mul_ps(a0, _mm256_permute_ps(bj, 0x00));
+        r         = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_permute_ps(bj, 0x55)));
+        r         = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_permute_ps(bj, 0xaa)));
+        r         = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_permute_ps(bj, 0xff)));
+        _mm256_storeu_ps(&out.m[j], r);
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 a0 = _mm_load_ps(&a.m[0]);
+    __m128 a1 = _mm_load_ps(&a.m[4]);
+    __m128 a2 = _mm_load_ps(&a.m[8]);
+    __m128 a3 = _mm_load_ps(&a.m[12]);
+
+    for (int j = 0; j < 16; j += 4) {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b.m[j + 0]));
+        r        = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b.m[j + 1])));
+        r        = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b.m[j + 2])));
+        r        = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b.m[j + 3])));
+        _mm_store_ps(&out.m[j], r);
+    }
+#else
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            out.m[col * 4 + row] =
+                a.m[0 * 4 + row] * b.m[col * 4 + 0] + a.m[1 * 4 + row] * b.m[col * 4 + 1] +
+                a.m[2 * 4 + row] * b.m[col * 4 + 2] + a.m[3 * 4 + row] * b.m[col * 4 + 3];
+        }
+    }
+#endif
+}
+
+// Copies into write-combined (mapped GPU) memory without polluting the cache.
+// dst must be 16-byte aligned; call mat4StreamFence() before handing the
+// memory to the GPU.
+inline void mat4Stream(const Mat4& src, Mat4* dst)
+{
+#if defined(__SSE__) || defined(_M_X64)
+    _mm_stream_ps(&dst->m[0], _mm_load_ps(&src.m[0]));
+    _mm_stream_ps(&dst->m[4], _mm_load_ps(&src.m[4]));
+    _mm_stream_ps(&dst->m[8], _mm_load_ps(&src.m[8]));
+    _mm_stream_ps(&dst->m[12], _mm_load_ps(&src.m[12]));
+#else
+    std::memcpy(dst, &src, sizeof(Mat4));
+#endif
+}
+
+inline void mat4StreamFence()
+{
+#if defined(__SSE__) || defined(_M_X64)
+    _mm_sfence();
+#endif
+}
@@ -0,0 +1,126 @@
+#include "memory_stats.h"
+
+#include "profiler.h"
+
+#include <ostream>
+#include <string>
+
+namespace {
+
+// Without VK_EXT_memory_budget assume we may use most of a heap, like other
+// allocators do
+constexpr double FALLBACK_BUDGET_FRACTION = 0.8;
+
+constexpr double MIB = 1024.0 * 1024.0;
+
+enum Counter { BUDGET, USAGE, ALLOCATED, COUNTER_COUNT };
+
+// Trace counter names must outlive the profiler
+const char* counterName(uint32_t heapIndex, Counter counter)
+{
+    static std::vector<std::string> names;
+    if (names.empty()) {
+        for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; ++i) {
+            for (const char* suffix : {"budget", "usage", "allocated"})
+                names.push_back("heap" + std::to_string(i) + ' ' + suffix + " (MiB)");
+        }
+    }
+    return names[heapIndex * COUNTER_COUNT + counter].c_str();
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void MemoryStats::init(VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled)
+{
+    m_physicalDevice         = physicalDevice;
+    m_budgetExtensionEnabled = budgetExtensionEnabled;
+
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+    m_heaps.resize(m_memoryProperties.memoryHeapCount);
+    m_underPressure.assign(m_heaps.size(), false);
+    for (size_t i = 0; i < m_heaps.size(); ++i) {
+        const auto& heap       = m_memoryProperties.memoryHeaps[i];
+        m_heaps[i].size        = heap.size;
+        m_heaps[i].deviceLocal = heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+
+    update();
+}
+
+void MemoryStats::onAllocate(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    m_heaps[heapIndex].allocated += size;
+    m_allocations[memory] = {heapIndex, size};
+}
+
+void MemoryStats::onFree(VkDeviceMemory memory)
+{
+    auto it = m_allocations.find(memory);
+    if (it == m_allocations.end()) return;
+
+    m_heaps[it->second.heapIndex].allocated -= it->second.size;
+    m_allocations.erase(it);
+}
+
+void MemoryStats::update()
+{
+    PROFILE_ZONE("MemoryStats::update");
+
+    if (m_budgetExtensionEnabled) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+        budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budget;
+
+        vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &properties);
+
+        for (size_t i = 0; i < m_heaps.size(); ++i) {
+            m_heaps[i].budget = budget.heapBudget[i];
+            m_heaps[i].usage  = budget.heapUsage[i];
+        }
+    } else {
+        for (auto& heap : m_heaps) {
+            heap.budget = static_cast<VkDeviceSize>(heap.size * FALLBACK_BUDGET_FRACTION);
+            heap.usage  = heap.allocated;
+        }
+    }
+
+    for (uint32_t i = 0; i < m_heaps.size(); ++i) {
+        const auto& heap = m_heaps[i];
+
+        Profiler::recordCounter(counterName(i, BUDGET), heap.budget / MIB);
+        Profiler::recordCounter(counterName(i, USAGE), heap.usage / MIB);
+        Profiler::recordCounter(counterName(i, ALLOCATED), heap.allocated / MIB);
+
+        // Trim once per crossing, not on every update while over the threshold
+        bool underPressure = heap.usage > heap.budget * double{m_pressureThreshold};
+        if (underPressure && !m_underPressure[i]) {
+            for (const auto& trimmer : m_cacheTrimmers)
+                trimmer(i);
+        }
+        m_underPressure[i] = underPressure;
+    }
+}
+
+void MemoryStats::addCacheTrimmer(std::function<void(uint32_t)> trimmer)
+{
+    m_cacheTrimmers.push_back(std::move(trimmer));
+}
+
+void MemoryStats::print(std::ostream& out) const
+{
+    out << "Memory heaps" << (m_budgetExtensionEnabled ? "" : " (budget estimated)") << ":\n";
+    for (size_t i = 0; i < m_heaps.size(); ++i) {
+        const auto& heap = m_heaps[i];
+        out << "\theap" << i << (heap.deviceLocal ? " device-local" : " host") << ": usage "
+            << heap.usage / MIB << " / budget " << heap.budget / MIB << " MiB, allocated "
+            << heap.allocated / MIB << " MiB, size " << heap.size / MIB << " MiB"
+            << (m_underPressure[i] ? " [pressure]" : "") << '\n';
+    }
+}
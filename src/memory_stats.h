@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Per-heap view of device memory: the driver's budget and usage (from
+// VK_EXT_memory_budget when available) next to what we allocated ourselves.
+class MemoryStats
+{
+  public:
+    struct Heap
+    {
+        VkDeviceSize size      = 0;
+        VkDeviceSize budget    = 0; // How much this process may use before things degrade
+        VkDeviceSize usage     = 0; // This process's usage as seen by the driver
+        VkDeviceSize allocated = 0; // Our own accounting
+        bool deviceLocal       = false;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled);
+
+    void onAllocate(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size);
+    void onFree(VkDeviceMemory memory);
+
+    // Re-queries the budget, emits trace counters and runs the cache trimmers
+    // when a heap crosses the pressure threshold
+    void update();
+
+    // Called with the heap index when usage exceeds threshold * budget
+    void addCacheTrimmer(std::function<void(uint32_t)> trimmer);
+    void setPressureThreshold(float fraction) { m_pressureThreshold = fraction; }
+
+    const std::vector<Heap>& heaps() const { return m_heaps; }
+    bool budgetExtensionEnabled() const { return m_budgetExtensionEnabled; }
+
+    void print(std::ostream& out) const;
+
+  private:
+    struct Allocation
+    {
+        uint32_t heapIndex;
+        VkDeviceSize size;
+    };
+
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    bool m_budgetExtensionEnabled     = false;
+    float m_pressureThreshold         = 0.9f;
+
+    VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+    std::vector<Heap> m_heaps;
+    std::vector<bool> m_underPressure;
+    std::unordered_map<VkDeviceMemory, Allocation> m_allocations;
+    std::vector<std::function<void(uint32_t)>> m_cacheTrimmers;
+};
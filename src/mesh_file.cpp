@@ -0,0 +1,65 @@
+#include "mesh_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+MeshFile::MeshFile(const std::string& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error{"failed to open mesh file!"};
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(MeshFormat::Header))) {
+        close(fd);
+        throw std::runtime_error{"invalid mesh file!"};
+    }
+    m_size = st.st_size;
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED) throw std::runtime_error{"failed to map mesh file!"};
+
+    m_data   = static_cast<const std::byte*>(data);
+    m_header = reinterpret_cast<const MeshFormat::Header*>(m_data);
+
+    // Read front to back once; tell the kernel to start paging it in now.
+    // Advice values are not flags, so each needs its own call.
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    madvise(data, m_size, MADV_WILLNEED);
+
+    const auto& h = *m_header;
+    bool valid    = h.magic == MeshFormat::MAGIC && h.version == MeshFormat::VERSION &&
+                 h.vertexStride == sizeof(MeshFormat::Vertex) &&
+                 (h.indexSize == 2 || h.indexSize == 4) &&
+                 h.vertexOffset % MeshFormat::PAYLOAD_ALIGNMENT == 0 &&
+                 h.indexOffset % MeshFormat::PAYLOAD_ALIGNMENT == 0 &&
+                 h.vertexOffset + uint64_t{h.vertexCount} * h.vertexStride <= h.indexOffset &&
+                 h.payloadEnd() <= m_size && h.lodCount >= 1 &&
+                 h.lodCount <= MeshFormat::MAX_LODS && h.indexCount % 3 == 0;
+    for (uint32_t i = 0; valid && i < h.lodCount; ++i) {
+        const auto& lod = h.lods[i];
+        valid           = lod.firstIndex % 3 == 0 && lod.indexCount % 3 == 0 &&
+                          uint64_t{lod.firstIndex} + lod.indexCount <= h.indexCount;
+    }
+    // One pass over pages that are about to be copied anyway
+    valid = valid && MeshFormat::indicesInRange(m_data + h.indexOffset, h.indexCount,
+                                                h.indexSize, h.vertexCount);
+    if (!valid) {
+        munmap(data, m_size);
+        throw std::runtime_error{"invalid mesh file!"};
+    }
+}
+
+MeshFile::~MeshFile()
+{
+    munmap(const_cast<std::byte*>(m_data), m_size);
+}
+
+std::span<const std::byte> MeshFile::payload() const
+{
+    return {m_data + m_header->vertexOffset, m_data + m_header->payloadEnd()};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "mesh_format.h"
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+//------------------------------------------------------------------------------
+
+// Read-only memory mapping of a MeshFormat file. Nothing is parsed: the
+// header is validated and the payload is handed out as-is.
+class MeshFile
+{
+  public:
+    explicit MeshFile(const std::string& filename);
+    ~MeshFile();
+
+    MeshFile(const MeshFile&)            = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+
+    const MeshFormat::Header& header() const { return *m_header; }
+
+    // Vertices and indices as one block, ready to memcpy into staging memory
+    std::span<const std::byte> payload() const;
+
+    std::span<const MeshFormat::Lod> lods() const
+    {
+        return {m_header->lods, m_header->lods + m_header->lodCount};
+    }
+
+    // Offset of the indices within payload()
+    uint64_t indexPayloadOffset() const { return m_header->indexOffset - m_header->vertexOffset; }
+
+  private:
+    const std::byte* m_data = nullptr;
+    size_t m_size           = 0;
+    const MeshFormat::Header* m_header;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//------------------------------------------------------------------------------
+
+// Binary mesh container written by tools/meshconv and memory-mapped at
+// startup. Layout:
+//
+//   Header
+//   vertices  at header.vertexOffset, vertexCount * sizeof(Vertex)
+//   indices   at header.indexOffset, indexCount * indexSize
+//
+// The indices hold every level of detail back to back, finest first, all
+// referencing the same vertices; header.lods locates each level.
+//
+// Both payloads start on PAYLOAD_ALIGNMENT, and [vertexOffset, payloadEnd())
+// is copied to the GPU as one block, so the index buffer offset is simply
+// indexOffset - vertexOffset. Little-endian only.
+namespace MeshFormat {
+
+constexpr uint32_t MAGIC             = 0x4d54'5456; // "VTTM"
+constexpr uint32_t VERSION           = 2;
+constexpr uint32_t PAYLOAD_ALIGNMENT = 256;
+constexpr uint32_t MAX_LODS          = 8;
+
+struct Vertex
+{
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+// Range of the index buffer; level 0 is the full mesh
+struct Lod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // Largest vertex displacement from level 0, in mesh units
+    uint32_t reserved;
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t vertexStride; // sizeof(Vertex)
+    uint32_t indexCount;
+    uint32_t indexSize; // 2 or 4 bytes
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t lodCount; // 1 to MAX_LODS
+    uint32_t reserved;
+    Lod lods[MAX_LODS];
+
+    uint64_t payloadEnd() const { return indexOffset + uint64_t{indexCount} * indexSize; }
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) == 200);
+static_assert(std::is_trivially_copyable_v<Vertex> && sizeof(Vertex) == 32);
+
+constexpr uint64_t alignPayload(uint64_t offset)
+{
+    return (offset + PAYLOAD_ALIGNMENT - 1) & ~uint64_t{PAYLOAD_ALIGNMENT - 1};
+}
+
+template <typename Index>
+uint32_t maxIndex(const std::byte* indices, uint64_t count)
+{
+    Index result = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        Index index;
+        std::memcpy(&index, indices + i * sizeof(Index), sizeof(Index));
+        result = index > result ? index : result;
+    }
+    return result;
+}
+
+// Whether all count indices of indexSize bytes are below vertexCount.
+// Robust buffer access is not enabled, so indices from disk must be checked
+// before the GPU fetches vertices with them.
+inline bool indicesInRange(const std::byte* indices, uint64_t count, uint32_t indexSize,
+                           uint64_t vertexCount)
+{
+    if (count == 0) return true;
+    uint32_t max = indexSize == 2 ? maxIndex<uint16_t>(indices, count)
+                                  : maxIndex<uint32_t>(indices, count);
+    return max < vertexCount;
+}
+
+} // namespace MeshFormat
@@ -0,0 +1,285 @@
+#include "pipeline_compiler.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char* CACHE_FILE = "pipeline_cache.bin";
+
+// Drivers should reject data written by another device or driver version,
+// but not all of them do
+bool isCacheCompatible(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties)
+{
+    constexpr size_t HEADER_SIZE = 16 + VK_UUID_SIZE;
+    if (data.size() < HEADER_SIZE) return false;
+
+    uint32_t header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+
+    return header[0] >= HEADER_SIZE && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header[2] == properties.vendorID && header[3] == properties.deviceID &&
+           std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void PipelineCompiler::init(VkDevice device, VkPhysicalDevice physicalDevice,
+                            uint32_t framesInFlight, Builder builder)
+{
+    m_device         = device;
+    m_physicalDevice = physicalDevice;
+    m_framesInFlight = framesInFlight;
+    m_builder        = std::move(builder);
+
+    loadCache();
+}
+
+void PipelineCompiler::destroy()
+{
+    // Let in-flight compiles land so their pipelines can be destroyed too
+    while (m_pending > 0) {
+        std::vector<Result> results;
+        {
+            std::lock_guard<std::mutex> lock{m_resultsMutex};
+            results.swap(m_results);
+        }
+        for (const auto& result : results) {
+            --m_pending;
+            if (result.pipeline != VK_NULL_HANDLE)
+                vkDestroyPipeline(m_device, result.pipeline, nullptr);
+        }
+        std::this_thread::yield();
+    }
+
+    for (const auto& entry : m_entries) {
+        if (entry.pipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_device, entry.pipeline, nullptr);
+    }
+    for (const auto& retired : m_retired)
+        vkDestroyPipeline(m_device, retired.pipeline, nullptr);
+
+    m_entries.clear();
+    m_resolved.clear();
+    m_retired.clear();
+
+    saveCache();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    m_cache = VK_NULL_HANDLE;
+}
+
+uint32_t PipelineCompiler::compileNow(const PipelineDesc& desc)
+{
+    PROFILE_ZONE("PipelineCompiler::compileNow");
+
+    uint32_t id            = addEntry(desc, NO_FALLBACK);
+    m_entries[id].pipeline = m_builder(m_cache, desc);
+    resolve();
+
+    return id;
+}
+
+uint32_t PipelineCompiler::request(const PipelineDesc& desc, uint32_t fallback)
+{
+    uint32_t id = addEntry(desc, fallback);
+    startCompile(id);
+    resolve();
+
+    return id;
+}
+
+void PipelineCompiler::update(uint64_t frame)
+{
+    PROFILE_ZONE("PipelineCompiler::update");
+
+    // Before any result can restart a compile
+    if (m_trimCache && m_pending == 0) resetCache();
+
+    std::erase_if(m_retired, [&](const Retired& retired) {
+        if (retired.frame + m_framesInFlight > frame) return false;
+        vkDestroyPipeline(m_device, retired.pipeline, nullptr);
+        return true;
+    });
+
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock{m_resultsMutex};
+        results.swap(m_results);
+    }
+
+    for (const auto& result : results) {
+        auto& entry     = m_entries[result.id];
+        entry.compiling = false;
+        --m_pending;
+
+        // On failure keep whatever was there; fixing the shader triggers
+        // another attempt
+        if (result.pipeline != VK_NULL_HANDLE) {
+            if (entry.pipeline != VK_NULL_HANDLE) m_retired.push_back({entry.pipeline, frame});
+            entry.pipeline = result.pipeline;
+        }
+
+        if (entry.dirty) startCompile(result.id);
+    }
+    if (!results.empty()) resolve();
+
+    if (m_watchShaders && Profiler::now() >= m_nextPollTime) {
+        m_nextPollTime = Profiler::now() + WATCH_INTERVAL_NS;
+        pollShaderFiles();
+    }
+}
+
+uint32_t PipelineCompiler::addEntry(const PipelineDesc& desc, uint32_t fallback)
+{
+    watchFile(desc.vertexShader);
+    watchFile(desc.fragmentShader);
+
+    m_entries.push_back({desc, fallback});
+    return m_entries.size() - 1;
+}
+
+void PipelineCompiler::startCompile(uint32_t id)
+{
+    auto& entry     = m_entries[id];
+    entry.compiling = true;
+    entry.dirty     = false;
+    ++m_pending;
+
+    // The desc is copied, m_entries may grow while the worker runs
+    m_workers.submit([this, id, desc = entry.desc] {
+        PROFILE_ZONE("compilePipeline");
+
+        uint64_t start      = Profiler::now();
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        try {
+            pipeline = m_builder(m_cache, desc);
+            std::cout << "Compiled pipeline " << desc.vertexShader << " + " << desc.fragmentShader
+                      << " in " << (Profiler::now() - start) / 1e6 << " ms\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Pipeline " << desc.vertexShader << " + " << desc.fragmentShader << ": "
+                      << e.what() << '\n';
+        }
+
+        std::lock_guard<std::mutex> lock{m_resultsMutex};
+        m_results.push_back({id, pipeline});
+    });
+}
+
+void PipelineCompiler::watchFile(const std::string& filename)
+{
+    auto it = std::find_if(m_watched.cbegin(), m_watched.cend(),
+                           [&](const auto& watched) { return watched.first == filename; });
+    if (it != m_watched.cend()) return;
+
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(filename, error);
+    m_watched.push_back({filename, {time, time}});
+}
+
+void PipelineCompiler::pollShaderFiles()
+{
+    for (auto& [filename, watched] : m_watched) {
+        std::error_code error;
+        auto time = std::filesystem::last_write_time(filename, error);
+        if (error || time == watched.time) continue;
+
+        // Wait until the time is stable across two polls so a file still
+        // being written by glslc is not picked up
+        if (time != watched.candidate) {
+            watched.candidate = time;
+            continue;
+        }
+        watched.time = time;
+
+        std::cout << "Reloading pipelines using " << filename << '\n';
+        for (uint32_t id = 0; id < m_entries.size(); ++id) {
+            auto& entry = m_entries[id];
+            if (entry.desc.vertexShader != filename && entry.desc.fragmentShader != filename)
+                continue;
+
+            if (entry.compiling)
+                entry.dirty = true;
+            else
+                startCompile(id);
+        }
+    }
+}
+
+void PipelineCompiler::resolve()
+{
+    m_resolved.resize(m_entries.size(), VK_NULL_HANDLE);
+
+    bool changed = false;
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        const auto& entry   = m_entries[i];
+        VkPipeline pipeline = entry.pipeline;
+        if (pipeline == VK_NULL_HANDLE && entry.fallback != NO_FALLBACK)
+            pipeline = m_entries[entry.fallback].pipeline;
+
+        changed |= m_resolved[i] != pipeline;
+        m_resolved[i] = pipeline;
+    }
+
+    if (changed) ++m_generation;
+}
+
+void PipelineCompiler::trimCache()
+{
+    m_trimCache = true;
+    if (m_pending == 0) resetCache();
+}
+
+void PipelineCompiler::loadCache()
+{
+    std::vector<char> data;
+    std::ifstream file(CACHE_FILE, std::ios::binary);
+    if (file.is_open())
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+    if (!isCacheCompatible(data, properties)) data.clear();
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize           = data.size();
+    createInfo.pInitialData              = data.data();
+
+    if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS)
+        throw std::runtime_error{"failed to create pipeline cache!"};
+}
+
+void PipelineCompiler::saveCache()
+{
+    size_t size = 0;
+    vkGetPipelineCacheData(m_device, m_cache, &size, nullptr);
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS) return;
+
+    std::ofstream file(CACHE_FILE, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), size);
+    if (!file) std::cerr << "failed to write " << CACHE_FILE << '\n';
+}
+
+void PipelineCompiler::resetCache()
+{
+    PROFILE_ZONE("PipelineCompiler::resetCache");
+
+    saveCache();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    m_cache     = VK_NULL_HANDLE;
+    m_trimCache = false;
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS)
+        throw std::runtime_error{"failed to create pipeline cache!"};
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+struct PipelineDesc
+{
+    std::string vertexShader; // .spv paths, watched for changes
+    std::string fragmentShader;
+    bool meshVertices = false;
+    bool overlay      = false; // HudQuad instances, blended over the scene
+};
+
+// Builds pipelines on background threads against one shared VkPipelineCache
+// and hands them to the render thread between frames. Replaced pipelines are
+// kept alive until the frames that may still use them have retired.
+class PipelineCompiler
+{
+  public:
+    static constexpr uint32_t NO_FALLBACK = UINT32_MAX;
+
+    // Called on worker threads; must be thread-safe and throw on failure
+    using Builder = std::function<VkPipeline(VkPipelineCache, const PipelineDesc&)>;
+
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight,
+              Builder builder);
+
+    // Waits for outstanding compiles, saves the cache and destroys every pipeline
+    void destroy();
+
+    // Ids are dense and handed out in call order. Compiles on the calling
+    // thread, for pipelines that must exist before the first frame.
+    uint32_t compileNow(const PipelineDesc& desc);
+
+    // Queues a background compile. Until it is ready pipelines() holds the
+    // fallback's pipeline in its place, or VK_NULL_HANDLE to skip its draws.
+    uint32_t request(const PipelineDesc& desc, uint32_t fallback = NO_FALLBACK);
+
+    // Render thread, once per frame with the frame's fences waited on:
+    // publishes finished compiles, destroys retired pipelines and, every
+    // WATCH_INTERVAL_NS, rebuilds pipelines whose shader files changed
+    void update(uint64_t frame);
+
+    // On by default. Off keeps update() free of file system access and
+    // pipelines fixed for the run, as replays need.
+    void setWatchShaders(bool watch) { m_watchShaders = watch; }
+
+    // Indexed by pipeline id; only changes inside update()
+    std::span<const VkPipeline> pipelines() const { return m_resolved; }
+
+    // Bumped whenever pipelines() changes, so recorded commands can be
+    // invalidated
+    uint64_t generation() const { return m_generation; }
+
+    uint32_t pendingCount() const { return m_pending; }
+
+    // Saves the cache to disk and starts over with an empty one, releasing
+    // the driver's copy. Waits for update() if a compile is using the cache.
+    void trimCache();
+
+  private:
+    struct Entry
+    {
+        PipelineDesc desc;
+        uint32_t fallback;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        bool compiling      = false;
+        bool dirty          = false; // Changed again while compiling
+    };
+
+    struct Result
+    {
+        uint32_t id;
+        VkPipeline pipeline; // VK_NULL_HANDLE when the compile failed
+    };
+
+    struct Retired
+    {
+        VkPipeline pipeline;
+        uint64_t frame;
+    };
+
+    struct WatchedFile
+    {
+        std::filesystem::file_time_type time;
+        std::filesystem::file_time_type candidate; // Must be seen twice
+    };
+
+    uint32_t addEntry(const PipelineDesc& desc, uint32_t fallback);
+    void startCompile(uint32_t id);
+    void watchFile(const std::string& filename);
+    void pollShaderFiles();
+    void resolve();
+    void loadCache();
+    void saveCache();
+    void resetCache();
+
+    static constexpr uint64_t WATCH_INTERVAL_NS = 250'000'000;
+    static constexpr unsigned COMPILE_THREADS   = 2;
+
+    VkDevice m_device                 = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPipelineCache m_cache           = VK_NULL_HANDLE;
+    uint32_t m_framesInFlight         = 0;
+    Builder m_builder;
+
+    // Render thread only
+    std::vector<Entry> m_entries;
+    std::vector<VkPipeline> m_resolved;
+    std::vector<Retired> m_retired;
+    std::vector<std::pair<std::string, WatchedFile>> m_watched;
+    uint64_t m_generation   = 0;
+    uint64_t m_nextPollTime = 0;
+    uint32_t m_pending      = 0;
+    bool m_trimCache        = false;
+    bool m_watchShaders     = true;
+
+    std::mutex m_resultsMutex;
+    std::vector<Result> m_results;
+
+    // Declared last so workers are joined before anything they touch dies
+    ThreadPool m_workers{COMPILE_THREADS};
+};
@@ -0,0 +1,145 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Profiler::s_enabled{false};
+
+namespace {
+
+struct ZoneEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct CounterEvent
+{
+    const char* name;
+    uint64_t time;
+    double value;
+};
+
+// Single producer (the owning thread), single consumer (dump). The producer
+// never waits: once full, the oldest events are overwritten and the consumer
+// drops whatever was overwritten while it was copying.
+template <typename Event, uint64_t CAPACITY = 1u << 16>
+struct RingBuffer
+{
+    std::array<Event, CAPACITY> events;
+    std::atomic<uint64_t> head{0};
+    uint32_t threadId = 0;
+
+    void push(const Event& event)
+    {
+        uint64_t h                 = head.load(std::memory_order_relaxed);
+        events[h & (CAPACITY - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    std::vector<Event> snapshot() const
+    {
+        uint64_t h     = head.load(std::memory_order_acquire);
+        uint64_t first = h > CAPACITY ? h - CAPACITY : 0;
+
+        std::vector<Event> out;
+        out.reserve(h - first);
+        for (uint64_t i = first; i < h; ++i)
+            out.push_back(events[i & (CAPACITY - 1)]);
+
+        // Entries the producer lapped while we were copying are garbage, and
+        // so is the slot it may be writing now, which head does not count yet
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now    = head.load(std::memory_order_relaxed);
+        uint64_t intact = now + 1 > CAPACITY ? now + 1 - CAPACITY : 0; // Oldest untouched index
+        uint64_t lapped = intact > first ? intact - first : 0;
+        out.erase(out.begin(), out.begin() + std::min<uint64_t>(lapped, out.size()));
+        return out;
+    }
+};
+
+constexpr uint32_t GPU_TRACK_ID = 0;
+
+std::mutex g_registryMutex;
+// Never freed, threads may exit before dump
+std::vector<std::unique_ptr<RingBuffer<ZoneEvent>>> g_buffers;
+RingBuffer<ZoneEvent> g_gpuBuffer;
+RingBuffer<CounterEvent, 1u << 12> g_counterBuffer;
+
+thread_local RingBuffer<ZoneEvent>* t_buffer = nullptr;
+
+RingBuffer<ZoneEvent>* threadBuffer()
+{
+    if (!t_buffer) {
+        auto buffer = std::make_unique<RingBuffer<ZoneEvent>>();
+
+        std::lock_guard<std::mutex> lock{g_registryMutex};
+        buffer->threadId = g_buffers.size() + 1;
+        t_buffer         = buffer.get();
+        g_buffers.push_back(std::move(buffer));
+    }
+    return t_buffer;
+}
+
+// Every event follows the GPU track metadata, so always lead with a separator
+void writeEvents(std::ofstream& out, const RingBuffer<ZoneEvent>& buffer)
+{
+    for (const auto& e : buffer.snapshot()) {
+        out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << buffer.threadId << ",\"ts\":" << e.begin / 1000.0
+            << ",\"dur\":" << (e.end - e.begin) / 1000.0 << '}';
+    }
+}
+
+void writeEvents(std::ofstream& out, const RingBuffer<CounterEvent, 1u << 12>& buffer)
+{
+    for (const auto& e : buffer.snapshot()) {
+        out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+            << e.time / 1000.0 << ",\"args\":{\"value\":" << e.value << "}}";
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+    threadBuffer()->push({name, begin, end});
+}
+
+void Profiler::recordGpu(const char* name, uint64_t begin, uint64_t end)
+{
+    if (isEnabled()) g_gpuBuffer.push({name, begin, end});
+}
+
+void Profiler::recordCounter(const char* name, double value)
+{
+    if (isEnabled()) g_counterBuffer.push({name, now(), value});
+}
+
+bool Profiler::dump(const std::string& filename)
+{
+    std::ofstream out{filename};
+    if (!out.is_open()) return false;
+
+    out.precision(3);
+    out << std::fixed << "{\"traceEvents\":[\n";
+
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TRACK_ID
+        << ",\"args\":{\"name\":\"GPU\"}}";
+    writeEvents(out, g_gpuBuffer);
+    writeEvents(out, g_counterBuffer);
+
+    std::lock_guard<std::mutex> lock{g_registryMutex};
+    for (const auto& buffer : g_buffers)
+        writeEvents(out, *buffer);
+
+    out << "\n]}\n";
+    return out.good();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+//------------------------------------------------------------------------------
+
+// Scoped CPU zones are written into per-thread lock-free ring buffers and can
+// be dumped at any time as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Timestamps are CLOCK_MONOTONIC nanoseconds so GPU timestamps converted to
+// the same domain land on the same timeline.
+class Profiler
+{
+  public:
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // name must outlive the profiler (string literals)
+    static void record(const char* name, uint64_t begin, uint64_t end);
+
+    // Only called from the render thread
+    static void recordGpu(const char* name, uint64_t begin, uint64_t end);
+    static void recordCounter(const char* name, double value);
+
+    static bool dump(const std::string& filename);
+
+  private:
+    static std::atomic<bool> s_enabled;
+};
+
+//------------------------------------------------------------------------------
+
+class ProfileZone
+{
+  public:
+    explicit ProfileZone(const char* name)
+        : m_name{Profiler::isEnabled() ? name : nullptr}
+        , m_begin{m_name ? Profiler::now() : 0}
+    {
+    }
+
+    ~ProfileZone()
+    {
+        if (m_name) Profiler::record(m_name, m_begin, Profiler::now());
+    }
+
+    ProfileZone(const ProfileZone&)            = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+  private:
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__){name}
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,732 @@
+#include "render_graph.h"
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+namespace {
+
+struct UsageInfo
+{
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags imageUsage;
+};
+
+UsageInfo usageInfo(RenderGraph::Usage usage)
+{
+    switch (usage) {
+    case RenderGraph::Usage::ColorAttachment:
+        return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+    case RenderGraph::Usage::DepthAttachment:
+        return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+    case RenderGraph::Usage::Sampled:
+        return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+    case RenderGraph::Usage::TransferSrc:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+    case RenderGraph::Usage::TransferDst:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+    case RenderGraph::Usage::VertexBuffer:
+        return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, 0};
+    }
+    return {};
+}
+
+// Only writes need to be made available by a barrier
+constexpr VkAccessFlags WRITE_ACCESS =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+constexpr VkImageUsageFlags ATTACHMENT_USAGE =
+    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+bool overlaps(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB)
+{
+    return firstA <= lastB && firstB <= lastA;
+}
+
+VkDeviceSize alignUp(VkDeviceSize offset, VkDeviceSize alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+std::string stageNames(VkPipelineStageFlags stages)
+{
+    static const std::pair<VkPipelineStageFlags, const char*> names[] = {
+        {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, "TOP_OF_PIPE"},
+        {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, "VERTEX_INPUT"},
+        {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, "VERTEX_SHADER"},
+        {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, "FRAGMENT_SHADER"},
+        {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, "EARLY_FRAGMENT_TESTS"},
+        {VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, "LATE_FRAGMENT_TESTS"},
+        {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "COLOR_ATTACHMENT_OUTPUT"},
+        {VK_PIPELINE_STAGE_TRANSFER_BIT, "TRANSFER"},
+        {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, "BOTTOM_OF_PIPE"},
+        {VK_PIPELINE_STAGE_HOST_BIT, "HOST"},
+    };
+
+    std::string result;
+    for (const auto& [bit, name] : names) {
+        if ((stages & bit) == 0) continue;
+        if (!result.empty()) result += '|';
+        result += name;
+    }
+    return result.empty() ? "NONE" : result;
+}
+
+const char* layoutName(VkImageLayout layout)
+{
+    switch (layout) {
+    case VK_IMAGE_LAYOUT_UNDEFINED: return "UNDEFINED";
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "COLOR_ATTACHMENT";
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT";
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY";
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "TRANSFER_SRC";
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "TRANSFER_DST";
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "PRESENT_SRC";
+    default: return "OTHER";
+    }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+void RenderGraph::init(VkDevice device, Allocator allocator)
+{
+    m_device    = device;
+    m_allocator = std::move(allocator);
+}
+
+void RenderGraph::destroy()
+{
+    releaseAllocations();
+
+    for (auto& pass : m_passes) {
+        if (pass.renderPass != VK_NULL_HANDLE)
+            vkDestroyRenderPass(m_device, pass.renderPass, nullptr);
+    }
+
+    m_resources.clear();
+    m_passes.clear();
+    m_schedule.clear();
+    m_batches.clear();
+    m_compiled = false;
+}
+
+RenderGraph::ResourceId RenderGraph::addResource(Resource resource)
+{
+    if (m_compiled) throw std::runtime_error{"render graph is already compiled!"};
+
+    m_resources.push_back(std::move(resource));
+    return m_resources.size() - 1;
+}
+
+RenderGraph::ResourceId RenderGraph::createImage(const char* name, VkFormat format,
+                                                 VkImageAspectFlags aspect)
+{
+    Resource resource;
+    resource.name   = name;
+    resource.image  = true;
+    resource.format = format;
+    resource.aspect = aspect;
+    return addResource(std::move(resource));
+}
+
+RenderGraph::ResourceId RenderGraph::importImage(const char* name, VkFormat format,
+                                                 VkPipelineStageFlags initialStage,
+                                                 VkImageLayout finalLayout)
+{
+    Resource resource;
+    resource.name         = name;
+    resource.image        = true;
+    resource.imported     = true;
+    resource.format       = format;
+    resource.aspect       = VK_IMAGE_ASPECT_COLOR_BIT;
+    resource.initialStage = initialStage;
+    resource.finalLayout  = finalLayout;
+    return addResource(std::move(resource));
+}
+
+RenderGraph::ResourceId RenderGraph::importBuffer(const char* name)
+{
+    Resource resource;
+    resource.name     = name;
+    resource.imported = true;
+    return addResource(std::move(resource));
+}
+
+RenderGraph::PassId RenderGraph::addPass(const char* name, RecordFn record)
+{
+    if (m_compiled) throw std::runtime_error{"render graph is already compiled!"};
+
+    Pass& added  = m_passes.emplace_back();
+    added.name   = name;
+    added.record = std::move(record);
+    return m_passes.size() - 1;
+}
+
+void RenderGraph::attach(PassId pass, ResourceId image, std::optional<VkClearValue> clear)
+{
+    Usage usage = (m_resources[image].aspect & VK_IMAGE_ASPECT_DEPTH_BIT)
+                      ? Usage::DepthAttachment
+                      : Usage::ColorAttachment;
+    m_passes[pass].accesses.push_back({image, usage, true, true, clear});
+}
+
+void RenderGraph::read(PassId pass, ResourceId resource, Usage usage)
+{
+    m_passes[pass].accesses.push_back({resource, usage, false, false, std::nullopt});
+}
+
+void RenderGraph::write(PassId pass, ResourceId resource, Usage usage)
+{
+    m_passes[pass].accesses.push_back({resource, usage, true, false, std::nullopt});
+}
+
+void RenderGraph::compile()
+{
+    PROFILE_ZONE("RenderGraph::compile");
+
+    if (m_compiled) throw std::runtime_error{"render graph is already compiled!"};
+
+    // Passes are declared in submission order, which is already a valid
+    // topological order of their dependencies
+    cullPasses();
+    for (PassId pass = 0; pass < m_passes.size(); ++pass) {
+        if (!m_passes[pass].culled) m_schedule.push_back(pass);
+    }
+
+    computeBarriers();
+    for (uint32_t i = 0; i < m_schedule.size(); ++i)
+        createRenderPass(m_passes[m_schedule[i]], i);
+
+    m_compiled = true;
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walk back from the outputs; a pass survives if something still needed
+    // is written by it. Loading an attachment counts as reading it.
+    std::vector<bool> needed(m_resources.size());
+    for (ResourceId id = 0; id < m_resources.size(); ++id)
+        needed[id] = m_resources[id].imported;
+
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+        pass->culled = std::none_of(pass->accesses.cbegin(), pass->accesses.cend(),
+                                    [&](const Access& access) {
+                                        return access.write && needed[access.resource];
+                                    });
+        if (pass->culled) continue;
+
+        for (const auto& access : pass->accesses) {
+            if (!access.write || (access.attachment && !access.clear))
+                needed[access.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::computeBarriers()
+{
+    struct State
+    {
+        VkImageLayout layout               = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages   = 0;
+        VkAccessFlags writeAccess          = 0;
+        VkPipelineStageFlags readStages    = 0; // Since the last write
+        VkPipelineStageFlags visibleStages = 0; // Last write already made visible to
+        VkAccessFlags visibleAccess        = 0;
+    };
+
+    std::vector<State> states(m_resources.size());
+    for (ResourceId id = 0; id < m_resources.size(); ++id) {
+        if (m_resources[id].imported && m_resources[id].image)
+            states[id].writeStages = m_resources[id].initialStage;
+    }
+
+    m_batches.assign(m_schedule.size() + 1, {});
+
+    for (uint32_t i = 0; i < m_schedule.size(); ++i) {
+        auto& batch = m_batches[i];
+
+        for (const auto& access : m_passes[m_schedule[i]].accesses) {
+            auto& resource = m_resources[access.resource];
+            auto& state    = states[access.resource];
+            UsageInfo info = usageInfo(access.usage);
+
+            resource.firstUse = std::min(resource.firstUse, i);
+            resource.lastUse  = i;
+            resource.usage |= info.imageUsage;
+
+            VkPipelineStageFlags pending = state.writeStages | state.readStages;
+
+            if (resource.image && state.layout != info.layout) {
+                // A transition is a write, it waits for earlier reads as well
+                batch.images.push_back({access.resource, state.layout, info.layout,
+                                        state.writeAccess, info.access});
+                batch.srcStages |= pending;
+                if (!pending) batch.srcStages |= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                batch.dstStages |= info.stages;
+                state = {info.layout};
+            } else if (access.write) {
+                if (pending) {
+                    batch.srcStages |= pending;
+                    batch.dstStages |= info.stages;
+                    if (state.writeAccess) {
+                        batch.memorySrcAccess |= state.writeAccess;
+                        batch.memoryDstAccess |= info.access;
+                    }
+                }
+            } else if (state.writeStages && ((state.visibleStages & info.stages) != info.stages ||
+                                             (state.visibleAccess & info.access) != info.access)) {
+                batch.srcStages |= state.writeStages;
+                batch.dstStages |= info.stages;
+                batch.memorySrcAccess |= state.writeAccess;
+                batch.memoryDstAccess |= info.access;
+                state.visibleStages |= info.stages;
+                state.visibleAccess |= info.access;
+            }
+
+            if (access.write) {
+                state             = {state.layout};
+                state.writeStages = info.stages;
+                state.writeAccess = info.access & WRITE_ACCESS;
+            } else {
+                state.readStages |= info.stages;
+            }
+        }
+    }
+
+    auto& final = m_batches.back();
+    for (ResourceId id = 0; id < m_resources.size(); ++id) {
+        auto& resource = m_resources[id];
+        auto& state    = states[id];
+        if (resource.firstUse > resource.lastUse) continue;
+
+        resource.lastStages      = state.writeStages | state.readStages;
+        resource.lastWriteAccess = state.writeAccess;
+        if (!resource.imported) continue;
+
+        if (resource.image && resource.finalLayout != state.layout) {
+            final.images.push_back({id, state.layout, resource.finalLayout, state.writeAccess, 0});
+            final.srcStages |= resource.lastStages;
+            final.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        } else if (!resource.image && state.writeAccess) {
+            final.srcStages |= state.writeStages;
+            final.dstStages |= VK_PIPELINE_STAGE_HOST_BIT;
+            final.memorySrcAccess |= state.writeAccess;
+            final.memoryDstAccess |= VK_ACCESS_HOST_READ_BIT;
+        }
+    }
+}
+
+void RenderGraph::createRenderPass(Pass& pass, uint32_t index)
+{
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> colorRefs;
+    VkAttachmentReference depthRef = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+
+    for (const auto& access : pass.accesses) {
+        if (!access.attachment) continue;
+
+        const auto& resource = m_resources[access.resource];
+        UsageInfo info       = usageInfo(access.usage);
+
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        if (access.clear)
+            loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        else if (resource.firstUse < index)
+            loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+
+        bool keep = resource.imported || resource.lastUse > index;
+
+        // Layouts are changed by the graph's barriers, never by the render pass
+        VkAttachmentDescription attachment = {};
+        attachment.format                  = resource.format;
+        attachment.samples                 = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp                  = loadOp;
+        attachment.storeOp = keep ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout  = info.layout;
+        attachment.finalLayout    = info.layout;
+
+        VkAttachmentReference ref = {static_cast<uint32_t>(attachments.size()), info.layout};
+        if (access.usage == Usage::DepthAttachment)
+            depthRef = ref;
+        else
+            colorRefs.push_back(ref);
+
+        attachments.push_back(attachment);
+        pass.attachments.push_back(access.resource);
+        pass.clearValues.push_back(access.clear.value_or(VkClearValue{}));
+    }
+    if (attachments.empty()) return;
+
+    VkSubpassDescription subpass    = {};
+    subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount    = colorRefs.size();
+    subpass.pColorAttachments       = colorRefs.data();
+    subpass.pDepthStencilAttachment = depthRef.attachment != VK_ATTACHMENT_UNUSED ? &depthRef
+                                                                                  : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount        = attachments.size();
+    renderPassInfo.pAttachments           = attachments.data();
+    renderPassInfo.subpassCount           = 1;
+    renderPassInfo.pSubpasses             = &subpass;
+
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+        throw std::runtime_error{"failed to create render pass!"};
+}
+
+void RenderGraph::setImportedImages(ResourceId image, std::span<const VkImage> images,
+                                    std::span<const VkImageView> views)
+{
+    auto& resource  = m_resources[image];
+    resource.images = {images.begin(), images.end()};
+    resource.views  = {views.begin(), views.end()};
+}
+
+void RenderGraph::allocate(VkExtent2D extent)
+{
+    PROFILE_ZONE("RenderGraph::allocate");
+
+    if (!m_compiled) throw std::runtime_error{"render graph is not compiled!"};
+
+    releaseAllocations();
+    m_extent   = extent;
+    m_variants = 1;
+    for (const auto& resource : m_resources) {
+        if (!resource.imported || !resource.image || resource.firstUse > resource.lastUse)
+            continue;
+        if (resource.images.empty())
+            throw std::runtime_error{"imported image " + resource.name + " is not bound!"};
+        m_variants = std::max<uint32_t>(m_variants, resource.images.size());
+    }
+
+    placeTransients();
+    createFramebuffers();
+    for (auto& batch : m_batches)
+        finalizeBatch(batch);
+}
+
+void RenderGraph::placeTransients()
+{
+    std::vector<ResourceId> transients;
+    std::vector<VkMemoryRequirements> requirements(m_resources.size());
+
+    for (ResourceId id = 0; id < m_resources.size(); ++id) {
+        auto& resource = m_resources[id];
+        if (resource.imported || !resource.image || resource.firstUse > resource.lastUse)
+            continue;
+
+        // Attachments nobody samples or copies never need to leave tile memory
+        VkImageUsageFlags usage = resource.usage;
+        if ((usage & ~ATTACHMENT_USAGE) == 0) usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType         = VK_IMAGE_TYPE_2D;
+        imageInfo.format            = resource.format;
+        imageInfo.extent            = {m_extent.width, m_extent.height, 1};
+        imageInfo.mipLevels         = 1;
+        imageInfo.arrayLayers       = 1;
+        imageInfo.samples           = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling            = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage             = usage;
+        imageInfo.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image;
+        if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+            throw std::runtime_error{"failed to create image!"};
+
+        resource.images = {image};
+        vkGetImageMemoryRequirements(m_device, image, &requirements[id]);
+        resource.size = requirements[id].size;
+        transients.push_back(id);
+    }
+
+    // Largest first, each at the lowest offset not used by a resource alive
+    // at the same time
+    std::stable_sort(transients.begin(), transients.end(), [&](ResourceId a, ResourceId b) {
+        return m_resources[a].size > m_resources[b].size;
+    });
+
+    std::vector<ResourceId> placed;
+    for (ResourceId id : transients) {
+        auto& resource          = m_resources[id];
+        const auto& requirement = requirements[id];
+
+        uint32_t block = 0;
+        for (; block < m_blocks.size(); ++block) {
+            if (m_blocks[block].memoryTypeBits & requirement.memoryTypeBits) break;
+        }
+        if (block == m_blocks.size())
+            m_blocks.push_back({requirement.memoryTypeBits, 0, VK_NULL_HANDLE});
+
+        std::vector<ResourceId> live;
+        std::vector<VkDeviceSize> candidates = {0};
+        for (ResourceId other : placed) {
+            const auto& o = m_resources[other];
+            if (o.block != block || !overlaps(resource.firstUse, resource.lastUse, o.firstUse,
+                                              o.lastUse))
+                continue;
+            live.push_back(other);
+            candidates.push_back(alignUp(o.offset + o.size, requirement.alignment));
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (VkDeviceSize offset : candidates) {
+            bool free = std::none_of(live.cbegin(), live.cend(), [&](ResourceId other) {
+                const auto& o = m_resources[other];
+                return offset < o.offset + o.size && o.offset < offset + resource.size;
+            });
+            if (!free) continue;
+
+            resource.offset = offset;
+            break;
+        }
+
+        resource.block = block;
+        m_blocks[block].memoryTypeBits &= requirement.memoryTypeBits;
+        m_blocks[block].size = std::max(m_blocks[block].size, resource.offset + resource.size);
+        placed.push_back(id);
+    }
+
+    for (auto& block : m_blocks) {
+        VkMemoryRequirements requirement = {block.size, 1, block.memoryTypeBits};
+        block.memory = m_allocator.allocate(requirement, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    for (ResourceId id : transients) {
+        auto& resource = m_resources[id];
+        vkBindImageMemory(m_device, resource.images[0], m_blocks[resource.block].memory,
+                          resource.offset);
+
+        VkImageViewCreateInfo viewInfo       = {};
+        viewInfo.sType                       = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image                       = resource.images[0];
+        viewInfo.viewType                    = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format                      = resource.format;
+        viewInfo.subresourceRange.aspectMask = resource.aspect;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+            throw std::runtime_error{"failed to create image view!"};
+        resource.views = {view};
+
+        resource.waitStages = 0;
+        resource.waitAccess = 0;
+        for (ResourceId other : transients) {
+            const auto& o = m_resources[other];
+            if (o.block != resource.block || resource.offset >= o.offset + o.size ||
+                o.offset >= resource.offset + resource.size)
+                continue;
+            resource.waitStages |= o.lastStages;
+            resource.waitAccess |= o.lastWriteAccess;
+        }
+    }
+}
+
+void RenderGraph::createFramebuffers()
+{
+    for (PassId id : m_schedule) {
+        auto& pass = m_passes[id];
+        if (pass.renderPass == VK_NULL_HANDLE) continue;
+
+        pass.framebuffers.resize(m_variants);
+        for (uint32_t variant = 0; variant < m_variants; ++variant) {
+            std::vector<VkImageView> views;
+            for (ResourceId attachment : pass.attachments) {
+                const auto& resource = m_resources[attachment];
+                views.push_back(resource.views[variant % resource.views.size()]);
+            }
+
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass              = pass.renderPass;
+            framebufferInfo.attachmentCount         = views.size();
+            framebufferInfo.pAttachments            = views.data();
+            framebufferInfo.width                   = m_extent.width;
+            framebufferInfo.height                  = m_extent.height;
+            framebufferInfo.layers                  = 1;
+
+            if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr,
+                                    &pass.framebuffers[variant]) != VK_SUCCESS)
+                throw std::runtime_error{"failed to create framebuffer!"};
+        }
+    }
+}
+
+void RenderGraph::finalizeBatch(Batch& batch)
+{
+    batch.issuedSrcStages = batch.srcStages;
+    batch.imageBarriers.assign(m_variants, {});
+
+    for (uint32_t variant = 0; variant < m_variants; ++variant) {
+        for (const auto& imageBarrier : batch.images) {
+            const auto& resource = m_resources[imageBarrier.resource];
+
+            VkImageMemoryBarrier barrier        = {};
+            barrier.sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask               = imageBarrier.srcAccess;
+            barrier.dstAccessMask               = imageBarrier.dstAccess;
+            barrier.oldLayout                   = imageBarrier.oldLayout;
+            barrier.newLayout                   = imageBarrier.newLayout;
+            barrier.srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image                       = resource.images[variant % resource.images.size()];
+            barrier.subresourceRange.aspectMask = resource.aspect;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.layerCount = 1;
+
+            if (!resource.imported && imageBarrier.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+                barrier.srcAccessMask |= resource.waitAccess;
+                batch.issuedSrcStages |= resource.waitStages;
+            }
+            batch.imageBarriers[variant].push_back(barrier);
+        }
+    }
+}
+
+void RenderGraph::releaseAllocations()
+{
+    for (auto& pass : m_passes) {
+        for (auto framebuffer : pass.framebuffers)
+            vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+        pass.framebuffers.clear();
+    }
+
+    for (auto& resource : m_resources) {
+        if (resource.imported) continue;
+        for (auto view : resource.views)
+            vkDestroyImageView(m_device, view, nullptr);
+        for (auto image : resource.images)
+            vkDestroyImage(m_device, image, nullptr);
+        resource.views.clear();
+        resource.images.clear();
+    }
+
+    for (const auto& block : m_blocks)
+        m_allocator.free(block.memory);
+    m_blocks.clear();
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t variant) const
+{
+    for (uint32_t i = 0; i < m_schedule.size(); ++i) {
+        issue(commandBuffer, m_batches[i], variant);
+
+        const auto& pass = m_passes[m_schedule[i]];
+        if (pass.renderPass == VK_NULL_HANDLE) {
+            pass.record(commandBuffer);
+            continue;
+        }
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType                 = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass            = pass.renderPass;
+        renderPassInfo.framebuffer           = pass.framebuffers[variant % m_variants];
+        renderPassInfo.renderArea.offset     = {0, 0};
+        renderPassInfo.renderArea.extent     = m_extent;
+        renderPassInfo.clearValueCount       = pass.clearValues.size();
+        renderPassInfo.pClearValues          = pass.clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        pass.record(commandBuffer);
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    issue(commandBuffer, m_batches.back(), variant);
+}
+
+void RenderGraph::issue(VkCommandBuffer commandBuffer, const Batch& batch, uint32_t variant) const
+{
+    if (batch.empty()) return;
+
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask   = batch.memorySrcAccess;
+    memoryBarrier.dstAccessMask   = batch.memoryDstAccess;
+    bool hasMemoryBarrier         = batch.memorySrcAccess != 0;
+
+    const auto& imageBarriers = batch.imageBarriers[variant % m_variants];
+    vkCmdPipelineBarrier(commandBuffer, batch.issuedSrcStages, batch.dstStages, 0,
+                         hasMemoryBarrier ? 1 : 0, &memoryBarrier, 0, nullptr,
+                         imageBarriers.size(), imageBarriers.data());
+}
+
+void RenderGraph::dump(std::ostream& out) const
+{
+    auto dumpBatch = [&](const Batch& batch) {
+        if (batch.empty()) return;
+
+        out << "    barrier " << stageNames(batch.issuedSrcStages) << " -> "
+            << stageNames(batch.dstStages) << '\n';
+        if (batch.memorySrcAccess)
+            out << "      memory 0x" << std::hex << batch.memorySrcAccess << " -> 0x"
+                << batch.memoryDstAccess << std::dec << '\n';
+        for (const auto& image : batch.images) {
+            out << "      " << m_resources[image.resource].name << ' '
+                << layoutName(image.oldLayout) << " -> " << layoutName(image.newLayout) << '\n';
+        }
+    };
+
+    out << "Render graph: " << m_passes.size() << " passes, "
+        << m_passes.size() - m_schedule.size() << " culled\n";
+    for (const auto& pass : m_passes) {
+        if (pass.culled) out << "  culled " << pass.name << '\n';
+    }
+
+    for (uint32_t i = 0; i < m_schedule.size(); ++i) {
+        const auto& pass = m_passes[m_schedule[i]];
+        dumpBatch(m_batches[i]);
+        out << "  " << i << ' ' << pass.name << '\n';
+
+        for (const auto& access : pass.accesses) {
+            const auto& resource = m_resources[access.resource];
+            out << "      " << (access.write ? "write " : "read ") << resource.name;
+            if (access.attachment)
+                out << (access.clear ? " clear" : resource.firstUse < i ? " load" : " dont_care")
+                    << (resource.imported || resource.lastUse > i ? " store" : " discard");
+            out << '\n';
+        }
+    }
+    out << "  end\n";
+    dumpBatch(m_batches.back());
+
+    VkDeviceSize unaliased = 0;
+    VkDeviceSize allocated = 0;
+    for (const auto& resource : m_resources) {
+        if (resource.imported || resource.images.empty()) continue;
+        out << "  transient " << resource.name << " passes " << resource.firstUse << ".."
+            << resource.lastUse << ", block " << resource.block << " offset " << resource.offset
+            << " size " << resource.size << '\n';
+        unaliased += resource.size;
+    }
+    for (const auto& block : m_blocks)
+        allocated += block.size;
+    out << "  transient memory " << allocated / 1024 << " KiB in " << m_blocks.size()
+        << " blocks, " << unaliased / 1024 << " KiB unaliased\n";
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Frame schedule over images and buffers. Passes declare how they use each
+// resource; compile() culls passes that contribute to no output, derives
+// batched barriers and layout transitions between the remaining ones and
+// builds their render passes. allocate() creates the transient attachments,
+// placing those whose lifetimes don't overlap in the same memory.
+//
+// Imported resources are outputs and their contents are not preserved
+// across frames. Buffer hazards use global memory barriers, so buffers are
+// tracked by id only; buffers written on the GPU are made visible to the
+// host at the end of the frame.
+class RenderGraph
+{
+  public:
+    using ResourceId = uint32_t;
+    using PassId     = uint32_t;
+    using RecordFn   = std::function<void(VkCommandBuffer)>;
+
+    enum class Usage
+    {
+        ColorAttachment,
+        DepthAttachment,
+        Sampled, // Fragment shader reads
+        TransferSrc,
+        TransferDst,
+        VertexBuffer, // Vertex and index fetch
+    };
+
+    // Device memory for transient attachments goes through these
+    struct Allocator
+    {
+        std::function<VkDeviceMemory(const VkMemoryRequirements&, VkMemoryPropertyFlags)> allocate;
+        std::function<void(VkDeviceMemory)> free;
+    };
+
+    void init(VkDevice device, Allocator allocator);
+    void destroy();
+
+    // Declarations, all before compile()
+
+    // Sized to the extent given to allocate()
+    ResourceId createImage(const char* name, VkFormat format, VkImageAspectFlags aspect);
+
+    // One image per variant, bound with setImportedImages(). The first use
+    // waits on initialStage, e.g. where the acquire semaphore is waited for.
+    ResourceId importImage(const char* name, VkFormat format, VkPipelineStageFlags initialStage,
+                           VkImageLayout finalLayout);
+
+    // Written by the host before submit, if at all
+    ResourceId importBuffer(const char* name);
+
+    // A pass with attachments records inside its own render pass
+    PassId addPass(const char* name, RecordFn record);
+
+    // Color or depth by the image's aspect; without a clear value the
+    // previous contents are loaded
+    void attach(PassId pass, ResourceId image, std::optional<VkClearValue> clear = std::nullopt);
+    void read(PassId pass, ResourceId resource, Usage usage);
+    void write(PassId pass, ResourceId resource, Usage usage);
+
+    void compile();
+
+    // Must be called for every imported image before allocate()
+    void setImportedImages(ResourceId image, std::span<const VkImage> images,
+                           std::span<const VkImageView> views);
+
+    // (Re)creates transient images, their memory and framebuffers
+    void allocate(VkExtent2D extent);
+
+    // variant selects the imported images, e.g. the swap chain image index
+    void execute(VkCommandBuffer commandBuffer, uint32_t variant) const;
+
+    VkRenderPass renderPass(PassId pass) const { return m_passes[pass].renderPass; }
+
+    void dump(std::ostream& out) const;
+
+  private:
+    struct Access
+    {
+        ResourceId resource;
+        Usage usage;
+        bool write;
+        bool attachment;
+        std::optional<VkClearValue> clear;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        RecordFn record;
+        std::vector<Access> accesses;
+        bool culled = false;
+
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<ResourceId> attachments; // Render pass attachment order
+        std::vector<VkClearValue> clearValues;
+        std::vector<VkFramebuffer> framebuffers; // Per variant
+    };
+
+    struct Resource
+    {
+        std::string name;
+        bool image                        = false;
+        bool imported                     = false;
+        VkFormat format                   = VK_FORMAT_UNDEFINED;
+        VkImageAspectFlags aspect         = 0;
+        VkPipelineStageFlags initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkImageLayout finalLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageUsageFlags usage           = 0;
+
+        // Lifetime over the schedule; firstUse > lastUse when unused
+        uint32_t firstUse               = UINT32_MAX;
+        uint32_t lastUse                = 0;
+        VkPipelineStageFlags lastStages = 0;
+        VkAccessFlags lastWriteAccess   = 0;
+
+        std::vector<VkImage> images; // Per variant for imported images
+        std::vector<VkImageView> views;
+
+        // Transient placement. The first use waits for every resource
+        // sharing its memory, this frame's and the previous frame's.
+        uint32_t block                  = 0;
+        VkDeviceSize offset             = 0;
+        VkDeviceSize size               = 0;
+        VkPipelineStageFlags waitStages = 0;
+        VkAccessFlags waitAccess        = 0;
+    };
+
+    struct ImageBarrier
+    {
+        ResourceId resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+
+    // One vkCmdPipelineBarrier
+    struct Batch
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags memorySrcAccess  = 0;
+        VkAccessFlags memoryDstAccess  = 0;
+        std::vector<ImageBarrier> images;
+
+        // Filled by allocate(), per variant
+        VkPipelineStageFlags issuedSrcStages = 0;
+        std::vector<std::vector<VkImageMemoryBarrier>> imageBarriers;
+
+        bool empty() const { return srcStages == 0 && dstStages == 0; }
+    };
+
+    struct Block
+    {
+        uint32_t memoryTypeBits;
+        VkDeviceSize size;
+        VkDeviceMemory memory;
+    };
+
+    ResourceId addResource(Resource resource);
+    void cullPasses();
+    void computeBarriers();
+    void createRenderPass(Pass& pass, uint32_t index);
+    void placeTransients();
+    void createFramebuffers();
+    void finalizeBatch(Batch& batch);
+    void releaseAllocations();
+    void issue(VkCommandBuffer commandBuffer, const Batch& batch, uint32_t variant) const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    Allocator m_allocator;
+    VkExtent2D m_extent = {};
+    uint32_t m_variants = 1;
+    bool m_compiled     = false;
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<PassId> m_schedule;
+
+    // m_batches[i] runs before m_schedule[i]; the last one after all passes
+    std::vector<Batch> m_batches;
+    std::vector<Block> m_blocks;
+};
@@ -0,0 +1,114 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace {
+
+struct ParallelForState
+{
+    const std::function<void(size_t, size_t)>* fn;
+    size_t begin;
+    size_t end;
+    size_t grain;
+    size_t chunkCount;
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<size_t> remaining;
+
+    // Returns once no chunks are left to claim. fn is only touched while a
+    // chunk is held, so late helpers never see a dangling pointer.
+    void run()
+    {
+        for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            size_t chunkBegin = begin + chunk * grain;
+            (*fn)(chunkBegin, std::min(chunkBegin + grain, end));
+            remaining.fetch_sub(1, std::memory_order_release);
+        }
+    }
+};
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(unsigned workerCount)
+{
+    for (unsigned i = 0; i < workerCount; ++i)
+        m_workers.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+unsigned ThreadPool::defaultWorkerCount()
+{
+    unsigned hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain,
+                             const std::function<void(size_t, size_t)>& fn)
+{
+    if (begin >= end) return;
+
+    grain             = std::max<size_t>(grain, 1);
+    size_t chunkCount = (end - begin + grain - 1) / grain;
+
+    if (chunkCount == 1 || m_workers.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    auto state        = std::make_shared<ParallelForState>();
+    state->fn         = &fn;
+    state->begin      = begin;
+    state->end        = end;
+    state->grain      = grain;
+    state->chunkCount = chunkCount;
+    state->remaining  = chunkCount;
+
+    size_t helpers = std::min<size_t>(chunkCount - 1, m_workers.size());
+    for (size_t i = 0; i < helpers; ++i)
+        submit([state] { state->run(); });
+
+    state->run();
+
+    while (state->remaining.load(std::memory_order_acquire) != 0)
+        std::this_thread::yield();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty()) return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+class ThreadPool
+{
+  public:
+    // The calling thread also works in parallelFor(), so by default leave one
+    // hardware thread for it
+    explicit ThreadPool(unsigned workerCount = defaultWorkerCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Workers plus the calling thread
+    unsigned concurrency() const { return m_workers.size() + 1; }
+
+    // Calls fn(chunkBegin, chunkEnd) over [begin, end) in chunks of at most
+    // grain elements and returns once every chunk is done
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+    // Runs task on a worker without waiting for it; pending tasks still run
+    // before the pool is destroyed
+    void submit(std::function<void()> task);
+
+    static unsigned defaultWorkerCount();
+
+  private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
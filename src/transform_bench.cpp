@@ -0,0 +1,118 @@
+// Microbenchmark for TransformSystem::update(): nodes recomputed per
+// millisecond for a wide, shallow hierarchy with a fraction of nodes animated
+// each frame. A partial update recomputes the animated nodes and their
+// descendants only.
+//
+// Usage: transform_bench [nodeCount] [dirtyPercent] [frames]
+
+#include "profiler.h"
+#include "thread_pool.h"
+#include "transforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Result
+{
+    double fullMs;
+    double partialMs;
+    double partialNodes; // Recomputed per partial update, on average
+};
+
+Result run(ThreadPool& pool, uint32_t nodeCount, uint32_t dirtyPercent, int frames)
+{
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+
+    // Roughly a scene graph: a few roots, ~8 children per node, 5-6 levels
+    TransformSystem transforms;
+    std::vector<TransformSystem::NodeId> nodes;
+    nodes.reserve(nodeCount);
+    auto parentOf = [](uint32_t i) { return i < 8 ? UINT32_MAX : (i - 8) / 8; };
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        auto parent = i < 8 ? TransformSystem::NO_PARENT : nodes[parentOf(i)];
+        auto node   = transforms.createNode(parent, true);
+        transforms.setTranslation(node, unit(rng), unit(rng), unit(rng));
+        nodes.push_back(node);
+    }
+
+    auto out = std::make_unique<Mat4[]>(transforms.instanceCount());
+
+    // First update computes everything
+    uint64_t start   = Profiler::now();
+    uint64_t version = transforms.update(pool, out.get(), 0);
+    double fullMs    = (Profiler::now() - start) / 1e6;
+
+    uint32_t dirtyCount = nodeCount * uint64_t{dirtyPercent} / 100;
+    double partialMs    = 0.0;
+    uint64_t recomputed = 0;
+    std::vector<uint8_t> changed(nodeCount);
+    for (int frame = 0; frame < frames; ++frame) {
+        std::fill(changed.begin(), changed.end(), 0);
+        for (uint32_t i = 0; i < dirtyCount; ++i) {
+            float angle    = 0.01f * frame;
+            uint32_t index = rng() % nodeCount;
+            transforms.setRotation(nodes[index], 0.0f, std::sin(angle), 0.0f, std::cos(angle));
+            changed[index] = 1;
+        }
+
+        // Parents are created before their children, so one pass reaches
+        // every descendant
+        for (uint32_t i = 0; i < nodeCount; ++i) {
+            if (parentOf(i) != UINT32_MAX) changed[i] |= changed[parentOf(i)];
+            recomputed += changed[i];
+        }
+
+        start   = Profiler::now();
+        version = transforms.update(pool, out.get(), version);
+        partialMs += (Profiler::now() - start) / 1e6;
+    }
+
+    return {fullMs, partialMs / frames, double(recomputed) / frames};
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint32_t nodeCount    = argc > 1 ? std::atoi(argv[1]) : 500'000;
+    uint32_t dirtyPercent = argc > 2 ? std::atoi(argv[2]) : 10;
+    int frames            = argc > 3 ? std::atoi(argv[3]) : 100;
+
+    if (nodeCount == 0 || frames <= 0) {
+        std::cerr << "usage: transform_bench [nodeCount > 0] [dirtyPercent] [frames > 0]\n";
+        return EXIT_FAILURE;
+    }
+
+#if defined(__AVX__)
+    const char* kernel = "AVX";
+#elif defined(__SSE__) || defined(_M_X64)
+    const char* kernel = "SSE";
+#else
+    const char* kernel = "scalar";
+#endif
+
+    std::cout << nodeCount << " nodes, " << dirtyPercent << "% dirty per frame, " << kernel
+              << " kernel\n";
+
+    for (unsigned workers : {0u, ThreadPool::defaultWorkerCount()}) {
+        ThreadPool pool{workers};
+        auto result = run(pool, nodeCount, dirtyPercent, frames);
+
+        std::cout << '\t' << pool.concurrency() << " thread(s): full update " << result.fullMs
+                  << " ms (" << nodeCount / result.fullMs << " nodes/ms), partial update "
+                  << result.partialMs << " ms for " << result.partialNodes << " nodes ("
+                  << result.partialNodes / result.partialMs << " nodes/ms)\n";
+
+        if (workers == ThreadPool::defaultWorkerCount()) break;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+#include "transforms.h"
+
+#include "profiler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Nodes per task; small enough to balance uneven levels, large enough that
+// a chunk's world matrices (64 bytes each) fill whole cache lines
+constexpr size_t UPDATE_GRAIN = 2048;
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+TransformSystem::NodeId TransformSystem::createNode(NodeId parent, bool renderable)
+{
+    if (parent != NO_PARENT && parent >= m_indexOf.size())
+        throw std::runtime_error{"invalid parent node!"};
+
+    NodeId node        = m_indexOf.size();
+    uint32_t index     = m_node.size();
+    uint32_t parentIdx = parent == NO_PARENT ? NO_PARENT : m_indexOf[parent];
+    uint32_t depth     = parent == NO_PARENT ? 0 : m_depth[parentIdx] + 1;
+
+    m_indexOf.push_back(index);
+    m_node.push_back(node);
+    m_parent.push_back(parentIdx);
+    m_depth.push_back(depth);
+    m_instanceSlot.push_back(renderable ? m_instanceCount++ : NO_INSTANCE);
+    m_tx.push_back(0.0f);
+    m_ty.push_back(0.0f);
+    m_tz.push_back(0.0f);
+    m_qx.push_back(0.0f);
+    m_qy.push_back(0.0f);
+    m_qz.push_back(0.0f);
+    m_qw.push_back(1.0f);
+    m_scale.push_back(1.0f);
+    m_dirty.push_back(1);
+    m_changedVersion.push_back(0);
+    m_world.push_back(Mat4::identity());
+
+    m_needsSort = true;
+    m_anyDirty  = true;
+    return node;
+}
+
+void TransformSystem::setTranslation(NodeId node, float x, float y, float z)
+{
+    uint32_t i = m_indexOf[node];
+    m_tx[i]    = x;
+    m_ty[i]    = y;
+    m_tz[i]    = z;
+    m_dirty[i] = 1;
+    m_anyDirty = true;
+}
+
+void TransformSystem::setRotation(NodeId node, float qx, float qy, float qz, float qw)
+{
+    uint32_t i = m_indexOf[node];
+    m_qx[i]    = qx;
+    m_qy[i]    = qy;
+    m_qz[i]    = qz;
+    m_qw[i]    = qw;
+    m_dirty[i] = 1;
+    m_anyDirty = true;
+}
+
+void TransformSystem::setScale(NodeId node, float scale)
+{
+    uint32_t i = m_indexOf[node];
+    m_scale[i] = scale;
+    m_dirty[i] = 1;
+    m_anyDirty = true;
+}
+
+uint64_t TransformSystem::update(ThreadPool& pool, Mat4* out, uint64_t outVersion)
+{
+    PROFILE_ZONE("TransformSystem::update");
+
+    if (m_needsSort) sortByDepth();
+
+    // Nothing moved: the version stays, and only an output buffer that is
+    // behind it gets written
+    bool dirty = m_anyDirty;
+    if (!dirty && outVersion >= m_version) return m_version;
+
+    uint64_t version = dirty ? ++m_version : m_version;
+    m_anyDirty       = false;
+
+    auto updateRange = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            uint32_t p = m_parent[i];
+
+            // Parents live in an earlier level, which is already finished
+            if (dirty && (m_dirty[i] || (p != NO_PARENT && m_changedVersion[p] == version))) {
+                Mat4 local = Mat4::fromTrs(m_tx[i], m_ty[i], m_tz[i], m_qx[i], m_qy[i], m_qz[i],
+                                           m_qw[i], m_scale[i]);
+                if (p == NO_PARENT)
+                    m_world[i] = local;
+                else
+                    mat4Multiply(m_world[p], local, m_world[i]);
+
+                m_dirty[i]          = 0;
+                m_changedVersion[i] = version;
+            }
+
+            if (out && m_instanceSlot[i] != NO_INSTANCE && m_changedVersion[i] > outVersion)
+                mat4Stream(m_world[i], &out[m_instanceSlot[i]]);
+        }
+        // Streaming stores are only ordered by a fence on the thread that issued them
+        mat4StreamFence();
+    };
+
+    for (size_t level = 0; level + 1 < m_levelBegin.size(); ++level)
+        pool.parallelFor(m_levelBegin[level], m_levelBegin[level + 1], UPDATE_GRAIN, updateRange);
+
+    return version;
+}
+
+void TransformSystem::sortByDepth()
+{
+    PROFILE_ZONE("TransformSystem::sortByDepth");
+
+    // Stable counting sort, so siblings keep their creation order
+    uint32_t levelCount = 0;
+    for (uint32_t depth : m_depth)
+        levelCount = std::max(levelCount, depth + 1);
+
+    m_levelBegin.assign(levelCount + 1, 0);
+    for (uint32_t depth : m_depth)
+        ++m_levelBegin[depth + 1];
+    for (uint32_t level = 0; level < levelCount; ++level)
+        m_levelBegin[level + 1] += m_levelBegin[level];
+
+    std::vector<uint32_t> cursor(m_levelBegin.begin(), m_levelBegin.end() - 1);
+    std::vector<uint32_t> newToOld(m_node.size());
+    std::vector<uint32_t> oldToNew(m_node.size());
+    for (uint32_t i = 0; i < m_node.size(); ++i) {
+        uint32_t newIndex  = cursor[m_depth[i]]++;
+        newToOld[newIndex] = i;
+        oldToNew[i]        = newIndex;
+    }
+
+    permute(m_node, newToOld);
+    permute(m_parent, newToOld);
+    permute(m_depth, newToOld);
+    permute(m_instanceSlot, newToOld);
+    permute(m_tx, newToOld);
+    permute(m_ty, newToOld);
+    permute(m_tz, newToOld);
+    permute(m_qx, newToOld);
+    permute(m_qy, newToOld);
+    permute(m_qz, newToOld);
+    permute(m_qw, newToOld);
+    permute(m_scale, newToOld);
+    permute(m_dirty, newToOld);
+    permute(m_changedVersion, newToOld);
+    permute(m_world, newToOld);
+
+    for (auto& parent : m_parent) {
+        if (parent != NO_PARENT) parent = oldToNew[parent];
+    }
+    for (uint32_t i = 0; i < m_node.size(); ++i)
+        m_indexOf[m_node[i]] = i;
+
+    m_needsSort = false;
+}
+
+template <typename T>
+void TransformSystem::permute(std::vector<T>& v, const std::vector<uint32_t>& newToOld)
+{
+    std::vector<T> sorted(v.size());
+    for (size_t i = 0; i < v.size(); ++i)
+        sorted[i] = v[newToOld[i]];
+    v.swap(sorted);
+}
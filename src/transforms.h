@@ -0,0 +1,67 @@
+#pragma once
+
+#include "mat4.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+//------------------------------------------------------------------------------
+
+// Transform hierarchy stored as structure-of-arrays. Nodes are kept sorted by
+// depth (so every parent precedes its children) and each depth level is
+// updated in parallel. NodeIds stay valid across the re-sorts.
+class TransformSystem
+{
+  public:
+    using NodeId = uint32_t;
+
+    static constexpr NodeId NO_PARENT     = UINT32_MAX;
+    static constexpr uint32_t NO_INSTANCE = UINT32_MAX;
+
+    // Renderable nodes get the next instance slot of the output buffer
+    NodeId createNode(NodeId parent, bool renderable);
+
+    void setTranslation(NodeId node, float x, float y, float z);
+    void setRotation(NodeId node, float qx, float qy, float qz, float qw);
+    void setScale(NodeId node, float scale);
+
+    // Recomputes world matrices of dirty nodes and their descendants, then
+    // writes every renderable node changed after outVersion into
+    // out[instanceSlot]. Pass the returned version back next time the same
+    // output buffer is updated; it only changes when some node did.
+    uint64_t update(ThreadPool& pool, Mat4* out, uint64_t outVersion);
+
+    const Mat4& worldMatrix(NodeId node) const { return m_world[m_indexOf[node]]; }
+
+    uint32_t nodeCount() const { return m_parent.size(); }
+    uint32_t instanceCount() const { return m_instanceCount; }
+
+  private:
+    void sortByDepth();
+
+    template <typename T>
+    static void permute(std::vector<T>& v, const std::vector<uint32_t>& newToOld);
+
+    // Indexed by NodeId
+    std::vector<uint32_t> m_indexOf;
+
+    // Indexed by storage position, depth-sorted
+    std::vector<NodeId> m_node;
+    std::vector<uint32_t> m_parent;
+    std::vector<uint32_t> m_depth;
+    std::vector<uint32_t> m_instanceSlot;
+    std::vector<float> m_tx, m_ty, m_tz;
+    std::vector<float> m_qx, m_qy, m_qz, m_qw;
+    std::vector<float> m_scale;
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint64_t> m_changedVersion;
+    std::vector<Mat4> m_world;
+
+    std::vector<uint32_t> m_levelBegin; // Level d is [m_levelBegin[d], m_levelBegin[d + 1])
+    bool m_needsSort         = false;
+    bool m_anyDirty          = false;
+    uint32_t m_instanceCount = 0;
+    uint64_t m_version       = 0; // Only advances when a node changed
+};
@@ -0,0 +1,548 @@
+// Offline converter from Wavefront OBJ to the MeshFormat container. Vertices
+// are deduplicated, triangles reordered for the post-transform vertex cache
+// and vertices reordered for fetch locality, so the runtime only has to mmap
+// the result. Simplified levels of detail are appended to the indices.
+//
+// Usage: meshconv input.obj output.vtm
+
+#include "mesh_format.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using MeshFormat::Vertex;
+
+namespace {
+
+struct Mesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices; // Every level, finest first
+    std::vector<MeshFormat::Lod> lods;
+};
+
+//------------------------------------------------------------------------------
+
+struct ObjIndex
+{
+    int position;
+    int uv;
+    int normal;
+
+    bool operator==(const ObjIndex&) const = default;
+};
+
+struct ObjIndexHash
+{
+    size_t operator()(const ObjIndex& i) const
+    {
+        return (size_t(i.position) * 73856093) ^ (size_t(i.uv) * 19349663) ^
+               (size_t(i.normal) * 83492791);
+    }
+};
+
+// OBJ indices are 1-based, negative ones count back from the end
+int resolveObjIndex(long index, size_t count)
+{
+    long resolved = index < 0 ? long(count) + index : index - 1;
+    if (resolved < 0 || resolved >= long(count))
+        throw std::runtime_error{"OBJ index out of range!"};
+    return int(resolved);
+}
+
+// Positions, normals and uvs of v/vt/vn/f lines; everything else is ignored.
+// Polygons are triangulated as fans.
+Mesh loadObj(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error{"failed to open file!"};
+    std::string text{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 3>> normals;
+    std::vector<std::array<float, 2>> uvs;
+
+    Mesh mesh;
+    std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> vertexMap;
+    std::vector<uint32_t> polygon;
+    bool missingNormals = false;
+
+    const char* p   = text.c_str();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) lineEnd = end;
+
+        char* cursor = const_cast<char*>(p);
+        if (p[0] == 'v' && p[1] == ' ') {
+            auto& v = positions.emplace_back();
+            cursor += 2;
+            for (float& c : v)
+                c = std::strtof(cursor, &cursor);
+        } else if (p[0] == 'v' && p[1] == 'n' && p[2] == ' ') {
+            auto& n = normals.emplace_back();
+            cursor += 3;
+            for (float& c : n)
+                c = std::strtof(cursor, &cursor);
+        } else if (p[0] == 'v' && p[1] == 't' && p[2] == ' ') {
+            auto& t = uvs.emplace_back();
+            cursor += 3;
+            for (float& c : t)
+                c = std::strtof(cursor, &cursor);
+        } else if (p[0] == 'f' && p[1] == ' ') {
+            cursor += 2;
+            polygon.clear();
+            while (true) {
+                while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t'))
+                    ++cursor;
+                if (cursor >= lineEnd || *cursor == '\r') break;
+
+                ObjIndex index = {resolveObjIndex(std::strtol(cursor, &cursor, 10),
+                                                  positions.size()),
+                                  -1, -1};
+                if (*cursor == '/') {
+                    if (*++cursor != '/')
+                        index.uv = resolveObjIndex(std::strtol(cursor, &cursor, 10), uvs.size());
+                    if (*cursor == '/')
+                        index.normal =
+                            resolveObjIndex(std::strtol(cursor + 1, &cursor, 10), normals.size());
+                }
+                missingNormals |= index.normal < 0;
+
+                auto [it, inserted] = vertexMap.try_emplace(index, mesh.vertices.size());
+                if (inserted) {
+                    Vertex vertex = {};
+                    std::copy_n(positions[index.position].data(), 3, vertex.position);
+                    if (index.normal >= 0)
+                        std::copy_n(normals[index.normal].data(), 3, vertex.normal);
+                    if (index.uv >= 0) std::copy_n(uvs[index.uv].data(), 2, vertex.uv);
+                    mesh.vertices.push_back(vertex);
+                }
+                polygon.push_back(it->second);
+            }
+
+            for (size_t i = 2; i < polygon.size(); ++i)
+                mesh.indices.insert(mesh.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+        }
+
+        p = lineEnd + 1;
+    }
+
+    if (missingNormals) {
+        // Area weighted face normals; vertices split only by uv still share
+        // the same position, so they may show a slight seam
+        for (auto& v : mesh.vertices)
+            std::fill_n(v.normal, 3, 0.0f);
+
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            Vertex* v[3] = {&mesh.vertices[mesh.indices[i]], &mesh.vertices[mesh.indices[i + 1]],
+                            &mesh.vertices[mesh.indices[i + 2]]};
+            float e1[3], e2[3];
+            for (int c = 0; c < 3; ++c) {
+                e1[c] = v[1]->position[c] - v[0]->position[c];
+                e2[c] = v[2]->position[c] - v[0]->position[c];
+            }
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                          e1[0] * e2[1] - e1[1] * e2[0]};
+            for (Vertex* vertex : v) {
+                for (int c = 0; c < 3; ++c)
+                    vertex->normal[c] += n[c];
+            }
+        }
+    }
+
+    for (auto& v : mesh.vertices) {
+        float length = std::sqrt(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] +
+                                 v.normal[2] * v.normal[2]);
+        if (length > 0.0f) {
+            for (float& c : v.normal)
+                c /= length;
+        }
+    }
+
+    return mesh;
+}
+
+//------------------------------------------------------------------------------
+
+// Centers the mesh on the origin and scales its largest extent to 1
+void normalize(Mesh& mesh, float boundsMin[3], float boundsMax[3])
+{
+    float lo[3] = {INFINITY, INFINITY, INFINITY};
+    float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (const auto& v : mesh.vertices) {
+        for (int c = 0; c < 3; ++c) {
+            lo[c] = std::min(lo[c], v.position[c]);
+            hi[c] = std::max(hi[c], v.position[c]);
+        }
+    }
+
+    float extent = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]});
+    float scale  = extent > 0.0f ? 1.0f / extent : 1.0f;
+    for (auto& v : mesh.vertices) {
+        for (int c = 0; c < 3; ++c)
+            v.position[c] = (v.position[c] - (lo[c] + hi[c]) * 0.5f) * scale;
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        boundsMax[c] = (hi[c] - lo[c]) * 0.5f * scale;
+        boundsMin[c] = -boundsMax[c];
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Forsyth's linear-speed vertex cache optimization: greedily emit the
+// triangle whose vertices score highest, favoring recently used vertices and
+// vertices with few triangles left.
+constexpr int CACHE_SIZE = 32;
+
+float vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // The last triangle's vertices get a fixed score so it is not
+        // immediately repeated
+        score = cachePosition < 3
+                    ? 0.75f
+                    : std::pow(1.0f - float(cachePosition - 3) / (CACHE_SIZE - 3), 1.5f);
+    }
+    return score + 2.0f / std::sqrt(float(remainingTriangles));
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    // Vertex -> triangles adjacency; the live part of each list shrinks as
+    // triangles are emitted
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices)
+        ++remaining[index];
+
+    std::vector<uint32_t> adjacencyBegin(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjacencyBegin[v + 1] = adjacencyBegin[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyBegin.begin(), adjacencyBegin.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(CACHE_SIZE + 3);
+    nextCache.reserve(CACHE_SIZE + 3);
+
+    size_t scanCursor = 0;
+    int64_t best      = -1;
+
+    while (result.size() < indices.size()) {
+        if (best < 0) {
+            // Nothing in the cache touches a pending triangle, restart from
+            // the next unemitted one
+            while (emitted[scanCursor])
+                ++scanCursor;
+            best = scanCursor;
+        }
+
+        emitted[best] = true;
+        nextCache.clear();
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = indices[best * 3 + k];
+            result.push_back(v);
+            nextCache.push_back(v);
+
+            auto first = adjacency.begin() + adjacencyBegin[v];
+            auto last  = first + remaining[v];
+            std::iter_swap(std::find(first, last, uint32_t(best)), last - 1);
+            --remaining[v];
+        }
+        for (uint32_t v : cache) {
+            if (std::find(nextCache.begin(), nextCache.begin() + 3, v) == nextCache.begin() + 3)
+                nextCache.push_back(v);
+        }
+
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            uint32_t v       = nextCache[i];
+            cachePosition[v] = i < CACHE_SIZE ? int(i) : -1;
+            score[v]         = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Only triangles touching the cache changed score; the best of them
+        // is the next candidate
+        best            = -1;
+        float bestScore = -1.0f;
+        for (uint32_t v : nextCache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                uint32_t t = adjacency[adjacencyBegin[v] + i];
+                float s    = score[indices[t * 3]] + score[indices[t * 3 + 1]] +
+                          score[indices[t * 3 + 2]];
+                if (s > bestScore) {
+                    bestScore = s;
+                    best      = t;
+                }
+            }
+        }
+
+        if (nextCache.size() > CACHE_SIZE) nextCache.resize(CACHE_SIZE);
+        cache.swap(nextCache);
+    }
+
+    indices.swap(result);
+}
+
+// Renumbers vertices in order of first use so the vertex fetch walks memory
+// linearly; unreferenced vertices are dropped
+void optimizeVertexFetch(Mesh& mesh)
+{
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices.swap(vertices);
+}
+
+//------------------------------------------------------------------------------
+
+// Vertex clustering: vertices falling in the same cell of a grid over the
+// unit cube collapse onto the one closest to the cell's average, and
+// triangles that become degenerate or duplicated are dropped. The result
+// reuses the mesh's vertices; uv seams are not preserved. Returns the
+// largest distance a vertex moved.
+float simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+               int grid, std::vector<uint32_t>& result)
+{
+    auto cellOf = [&](const Vertex& v) {
+        uint64_t key = 0;
+        for (float c : v.position)
+            key = key << 21 | std::clamp(int((c + 0.5f) * grid), 0, grid - 1);
+        return key;
+    };
+
+    std::unordered_map<uint64_t, uint32_t> clusterOfCell;
+    std::vector<uint32_t> cluster(vertices.size(), UINT32_MAX);
+    std::vector<std::array<float, 4>> sums; // Position sum and vertex count
+    for (uint32_t index : indices) {
+        if (cluster[index] != UINT32_MAX) continue;
+
+        auto [it, inserted] = clusterOfCell.try_emplace(cellOf(vertices[index]), sums.size());
+        if (inserted) sums.push_back({});
+        cluster[index] = it->second;
+
+        auto& sum = sums[it->second];
+        for (int c = 0; c < 3; ++c)
+            sum[c] += vertices[index].position[c];
+        sum[3] += 1.0f;
+    }
+
+    auto distance2 = [](const float* a, const float* b) {
+        float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    };
+
+    std::vector<uint32_t> representative(sums.size());
+    std::vector<float> bestDistance(sums.size(), INFINITY);
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        if (cluster[v] == UINT32_MAX) continue;
+
+        const auto& sum = sums[cluster[v]];
+        float mean[3]   = {sum[0] / sum[3], sum[1] / sum[3], sum[2] / sum[3]};
+        float d         = distance2(vertices[v].position, mean);
+        if (d < bestDistance[cluster[v]]) {
+            bestDistance[cluster[v]]   = d;
+            representative[cluster[v]] = v;
+        }
+    }
+
+    float error = 0.0f;
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        if (cluster[v] == UINT32_MAX) continue;
+        error = std::max(error, distance2(vertices[v].position,
+                                          vertices[representative[cluster[v]]].position));
+    }
+
+    // Rotated to start at the smallest index, which keeps the winding, so
+    // duplicates compare equal
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        std::array<uint32_t, 3> t = {representative[cluster[indices[i]]],
+                                     representative[cluster[indices[i + 1]]],
+                                     representative[cluster[indices[i + 2]]]};
+        if (t[0] == t[1] || t[1] == t[2] || t[0] == t[2]) continue;
+
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        triangles.push_back(t);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    result.clear();
+    for (const auto& t : triangles)
+        result.insert(result.end(), t.begin(), t.end());
+
+    return std::sqrt(error);
+}
+
+// Successively coarser grids, each simplified from level 0 so errors do not
+// compound. A level is kept only if it drops enough triangles to be worth
+// switching to.
+constexpr int FINEST_GRID          = 64;
+constexpr float MAX_LEVEL_RATIO    = 0.7f;
+constexpr size_t MIN_LOD_TRIANGLES = 4;
+
+void buildLods(Mesh& mesh)
+{
+    const std::vector<uint32_t> base = mesh.indices;
+    mesh.lods                        = {{0, uint32_t(base.size()), 0.0f, 0}};
+
+    std::vector<uint32_t> indices;
+    for (int grid = FINEST_GRID; grid >= 2 && mesh.lods.size() < MeshFormat::MAX_LODS;
+         grid /= 2) {
+        float error = simplify(mesh.vertices, base, grid, indices);
+        if (indices.size() / 3 < MIN_LOD_TRIANGLES) break;
+        if (indices.size() > mesh.lods.back().indexCount * MAX_LEVEL_RATIO) continue;
+
+        optimizeVertexCache(indices, mesh.vertices.size());
+        mesh.lods.push_back({uint32_t(mesh.indices.size()), uint32_t(indices.size()), error, 0});
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// Average cache misses per triangle for a FIFO cache of typical hardware size
+float acmr(const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    constexpr size_t FIFO_SIZE = 16;
+
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (uint32_t index : indices) {
+        if (insertedAt[index] == 0 || misses + 1 - insertedAt[index] > FIFO_SIZE)
+            insertedAt[index] = ++misses;
+    }
+    return indices.empty() ? 0.0f : float(misses) / (indices.size() / 3);
+}
+
+//------------------------------------------------------------------------------
+
+void writePadding(std::ofstream& file, uint64_t offset)
+{
+    static const char zeros[MeshFormat::PAYLOAD_ALIGNMENT] = {};
+    file.write(zeros, MeshFormat::alignPayload(offset) - offset);
+}
+
+void writeMesh(const std::string& filename, const Mesh& mesh, const float boundsMin[3],
+               const float boundsMax[3])
+{
+    bool shortIndices = mesh.vertices.size() <= UINT16_MAX;
+
+    MeshFormat::Header header = {};
+    header.magic              = MeshFormat::MAGIC;
+    header.version            = MeshFormat::VERSION;
+    header.vertexCount        = mesh.vertices.size();
+    header.vertexStride       = sizeof(Vertex);
+    header.indexCount         = mesh.indices.size();
+    header.indexSize          = shortIndices ? 2 : 4;
+    header.vertexOffset       = MeshFormat::alignPayload(sizeof(header));
+    header.indexOffset =
+        MeshFormat::alignPayload(header.vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+    std::copy_n(boundsMin, 3, header.boundsMin);
+    std::copy_n(boundsMax, 3, header.boundsMax);
+    header.lodCount = mesh.lods.size();
+    std::copy(mesh.lods.begin(), mesh.lods.end(), header.lods);
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) throw std::runtime_error{"failed to open output file!"};
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writePadding(file, sizeof(header));
+    file.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+               mesh.vertices.size() * sizeof(Vertex));
+    writePadding(file, header.vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+
+    if (shortIndices) {
+        std::vector<uint16_t> indices(mesh.indices.begin(), mesh.indices.end());
+        file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * 2);
+    } else {
+        file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * 4);
+    }
+
+    if (!file) throw std::runtime_error{"failed to write output file!"};
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " input.obj output.vtm\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+
+        Mesh mesh = loadObj(argv[1]);
+        if (mesh.indices.empty()) throw std::runtime_error{"no triangles in input!"};
+
+        float boundsMin[3], boundsMax[3];
+        normalize(mesh, boundsMin, boundsMax);
+
+        float acmrBefore = acmr(mesh.indices, mesh.vertices.size());
+        optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        optimizeVertexFetch(mesh);
+        float acmrAfter = acmr(mesh.indices, mesh.vertices.size());
+
+        buildLods(mesh);
+        writeMesh(argv[2], mesh, boundsMin, boundsMax);
+
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::cout << argv[2] << ": " << mesh.vertices.size() << " vertices, "
+                  << mesh.lods[0].indexCount / 3 << " triangles, ACMR " << acmrBefore << " -> "
+                  << acmrAfter << " (" << elapsed.count() << " ms)\n";
+        for (size_t i = 1; i < mesh.lods.size(); ++i) {
+            std::cout << "  LOD " << i << ": " << mesh.lods[i].indexCount / 3
+                      << " triangles, error " << mesh.lods[i].error << '\n';
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}